@@ -0,0 +1,504 @@
+/*
+* diff.c
+* Author: Rushy Panchal
+* Description: Compares two pixel buffers. Implements diff.h.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <assert.h>
+#include "diff.h"
+
+#define DIFF_BLOCK 64
+#define MAX_THREADS 256
+#define NO_REGION ((size_t) -1)
+
+/* Differences within a single DIFF_BLOCK x DIFF_BLOCK block. */
+struct Block {
+	size_t count; /* number of differing pixels */
+	size_t xmin; /* leftmost differing column */
+	size_t ymin; /* topmost differing row */
+	size_t xmax; /* rightmost differing column */
+	size_t ymax; /* bottommost differing row */
+	};
+
+struct Diff {
+	size_t count; /* number of differing pixels */
+	bool stopped; /* whether or not the comparison stopped early */
+	size_t region_count; /* number of regions */
+	struct DiffRegion *regions; /* regions of differing pixels */
+	};
+
+/* A comparison in progress: the buffers and the queue of bands left to
+compare. A band is one row of blocks. */
+struct Comparison {
+	const struct DiffBuffer *buffer; /* primary buffer */
+	const struct DiffBuffer *other; /* secondary buffer */
+	const struct DiffOptions *options; /* how to compare the buffers */
+	size_t width; /* width of the overlap */
+	size_t height; /* height of the overlap */
+	size_t pixel_size; /* bytes per pixel */
+	size_t blocks_across; /* number of blocks in each band */
+	size_t blocks_down; /* number of bands */
+	struct Block *blocks; /* blocks, in row-major order */
+	size_t next_band; /* next band to hand out */
+	pthread_mutex_t lock; /* protects next_band */
+	atomic_size_t count; /* differences found so far (with max_diffs) */
+	atomic_bool stop; /* whether or not max_diffs has been reached */
+	uint8_t tolerance8[DIFF_BLOCK * DIFF_MAX_CHANNELS]; /* tolerance of each
+	channel of a block row, for 1-byte channels */
+	uint16_t tolerance16[DIFF_BLOCK * DIFF_MAX_CHANNELS]; /* ... for 2-byte
+	channels */
+	uint32_t tolerance32[DIFF_BLOCK * DIFF_MAX_CHANNELS]; /* ... for 4-byte
+	channels */
+	};
+
+/* --- Internal Method Prototypes --- */
+/*
+* Compare bands from the queue until it is empty (or max_diffs is reached).
+* Parameters
+*	void *arg - (struct Comparison*) comparison to work on
+* Returns
+*	(void*) NULL
+*/
+static void *Diff_worker(void *arg);
+
+/*
+* Compare one block-wide segment of a row.
+* Parameters
+*	struct Comparison *comparison - comparison in progress
+*	const uint8_t *segment - segment of the primary buffer
+*	const uint8_t *other_segment - segment of the secondary buffer
+*	const size_t x0 - column of the first pixel in the segment
+*	const size_t y - row of the segment
+*	const size_t pixels - number of pixels in the segment
+*	struct Block *block - block that the segment is in
+* Returns
+*	(size_t) number of differing pixels in the segment
+*/
+static size_t Diff_segment(struct Comparison *comparison,
+	const uint8_t *segment, const uint8_t *other_segment, const size_t x0,
+	const size_t y, const size_t pixels, struct Block *block);
+
+/*
+* Flag every channel whose difference exceeds its tolerance. These are kept
+* as simple loops over flat arrays so that the compiler vectorizes them.
+* Parameters
+*	const uintN_t *a - channels of the primary buffer
+*	const uintN_t *b - channels of the secondary buffer
+*	const uintN_t *tolerance - tolerance of each channel
+*	const size_t n - number of channels
+*	uint8_t *exceeds - (n) flags to store the result in
+*/
+static void Diff_exceeds8(const uint8_t *a, const uint8_t *b,
+	const uint8_t *tolerance, const size_t n, uint8_t *exceeds);
+static void Diff_exceeds16(const uint16_t *a, const uint16_t *b,
+	const uint16_t *tolerance, const size_t n, uint8_t *exceeds);
+static void Diff_exceeds32(const uint32_t *a, const uint32_t *b,
+	const uint32_t *tolerance, const size_t n, uint8_t *exceeds);
+
+/*
+* Merge the differing blocks into 8-connected regions.
+* Parameters
+*	const struct Comparison *comparison - finished comparison
+*	Diff_T diff - result to store the regions in
+* Returns
+*	(bool) true on success, false on memory exhaustion
+*/
+static bool Diff_findRegions(const struct Comparison *comparison, Diff_T diff);
+
+/*
+* Find the root of a block in the union-find forest, compressing the path.
+* Parameters
+*	size_t *parents - parent of each block
+*	size_t index - block to find the root of
+* Returns
+*	(size_t) root of the block
+*/
+static size_t Diff_findRoot(size_t *parents, size_t index);
+
+/* Set the options to an exact comparison of 8-bit RGB pixels. */
+void Diff_defaultOptions(struct DiffOptions *options) {
+	assert(options != NULL);
+
+	memset(options, 0, sizeof(struct DiffOptions));
+	options->channels = 3;
+	options->channel_size = 1;
+	}
+
+/* Compare two buffers. */
+Diff_T Diff_compare(const struct DiffBuffer *buffer,
+	const struct DiffBuffer *other, const struct DiffOptions *options) {
+	Diff_T diff; /* result for client */
+	struct Comparison comparison; /* comparison in progress */
+	pthread_t workers[MAX_THREADS]; /* comparing threads */
+	unsigned threads; /* number of comparing threads */
+	unsigned t; /* current thread */
+	long cpus; /* number of online processors */
+	size_t outside; /* pixels outside of the overlap */
+	size_t index; /* current block index */
+	size_t i; /* current channel of a block row */
+
+	assert(buffer != NULL);
+	assert(other != NULL);
+	assert(options != NULL);
+	assert(options->channels > 0 && options->channels <= DIFF_MAX_CHANNELS);
+	assert(options->channel_size == 1 || options->channel_size == 2 ||
+		options->channel_size == 4);
+
+	diff = (Diff_T) calloc(1, sizeof(struct Diff));
+	if (diff == NULL) return NULL;
+
+	/* Only the overlap of the two buffers can be compared. */
+	comparison.buffer = buffer;
+	comparison.other = other;
+	comparison.options = options;
+	comparison.width = (buffer->width > other->width) ? other->width : buffer->width;
+	comparison.height = (buffer->height > other->height) ? other->height : buffer->height;
+	comparison.pixel_size = options->channels * options->channel_size;
+	comparison.blocks_across = (comparison.width + DIFF_BLOCK - 1) / DIFF_BLOCK;
+	comparison.blocks_down = (comparison.height + DIFF_BLOCK - 1) / DIFF_BLOCK;
+	comparison.next_band = 0;
+
+	/* Every pixel that is in only one of the buffers is a difference. The
+	overlap is subtracted from each size separately so that this cannot
+	underflow, whichever buffer is larger. */
+	outside = (buffer->width * buffer->height -
+		comparison.width * comparison.height) +
+		(other->width * other->height - comparison.width * comparison.height);
+	atomic_init(&comparison.count, outside);
+	atomic_init(&comparison.stop,
+		options->max_diffs != 0 && outside >= options->max_diffs);
+
+	comparison.blocks = (struct Block*) calloc(
+		comparison.blocks_across * comparison.blocks_down + 1, sizeof(struct Block));
+	if (comparison.blocks == NULL) {
+		free(diff);
+		return NULL;
+		}
+
+	for (i = 0; i < DIFF_BLOCK * options->channels; i++) {
+		comparison.tolerance8[i] = (options->tolerance[i % options->channels] > UINT8_MAX) ?
+			UINT8_MAX : options->tolerance[i % options->channels];
+		comparison.tolerance16[i] = (options->tolerance[i % options->channels] > UINT16_MAX) ?
+			UINT16_MAX : options->tolerance[i % options->channels];
+		comparison.tolerance32[i] = options->tolerance[i % options->channels];
+		}
+
+	/* One thread per processor (unless requested otherwise), but no more
+	threads than there are bands. */
+	cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	threads = (options->threads != 0) ? options->threads :
+		(cpus < 1) ? 1 : (unsigned) cpus;
+	if (threads > MAX_THREADS) threads = MAX_THREADS;
+	if (threads > comparison.blocks_down) threads = comparison.blocks_down;
+	if (threads == 0) threads = 1;
+
+	pthread_mutex_init(&comparison.lock, NULL);
+
+	/* The calling thread takes part; if a thread cannot be started, the others
+	simply pick up its share of the bands. */
+	for (t = 1; t < threads; t++) {
+		if (pthread_create(workers + t, NULL, Diff_worker, &comparison) != 0)
+			break;
+		}
+	threads = t;
+
+	Diff_worker(&comparison);
+	for (t = 1; t < threads; t++) pthread_join(workers[t], NULL);
+
+	pthread_mutex_destroy(&comparison.lock);
+
+	diff->count = outside;
+	for (index = 0; index < comparison.blocks_across * comparison.blocks_down; index++)
+		diff->count += comparison.blocks[index].count;
+	diff->stopped = atomic_load(&comparison.stop);
+
+	if (! Diff_findRegions(&comparison, diff)) {
+		free(comparison.blocks);
+		free(diff);
+		return NULL;
+		}
+
+	free(comparison.blocks);
+	return diff;
+	}
+
+/* Free the result of a comparison. */
+void Diff_free(Diff_T diff) {
+	if (diff != NULL) free(diff->regions);
+	free(diff);
+	}
+
+/* Get the number of differing pixels. */
+size_t Diff_getCount(const Diff_T diff) {
+	assert(diff != NULL);
+
+	return diff->count;
+	}
+
+/* Check whether the comparison stopped early. */
+bool Diff_stoppedEarly(const Diff_T diff) {
+	assert(diff != NULL);
+
+	return diff->stopped;
+	}
+
+/* Get the number of regions of differing pixels. */
+size_t Diff_getRegionCount(const Diff_T diff) {
+	assert(diff != NULL);
+
+	return diff->region_count;
+	}
+
+/* Get a region of differing pixels. */
+const struct DiffRegion *Diff_getRegion(const Diff_T diff, const size_t index) {
+	assert(diff != NULL);
+	assert(index < diff->region_count);
+
+	return diff->regions + index;
+	}
+
+/* --- Internal Methods --- */
+/* Compare bands from the queue until it is empty. */
+static void *Diff_worker(void *arg) {
+	struct Comparison *comparison = (struct Comparison*) arg; /* comparison */
+	const size_t pixel_size = comparison->pixel_size; /* bytes per pixel */
+	const size_t max_diffs = comparison->options->max_diffs; /* early exit */
+	size_t band; /* current band */
+	size_t y; /* current row */
+	size_t ymax; /* last row of the band (exclusive) */
+	size_t bx; /* current block within the band */
+	size_t x0; /* first column of the current block */
+	size_t pixels; /* pixels of the current block in this row */
+	size_t row_count; /* differing pixels in the current row */
+	const uint8_t *row; /* current row of the primary buffer */
+	const uint8_t *other_row; /* current row of the secondary buffer */
+
+	for (;;) {
+		pthread_mutex_lock(&comparison->lock);
+		band = comparison->next_band++;
+		pthread_mutex_unlock(&comparison->lock);
+		if (band >= comparison->blocks_down) break;
+
+		ymax = (band + 1) * DIFF_BLOCK;
+		if (ymax > comparison->height) ymax = comparison->height;
+
+		for (y = band * DIFF_BLOCK; y < ymax; y++) {
+			if (atomic_load_explicit(&comparison->stop, memory_order_relaxed))
+				return NULL;
+
+			row = comparison->buffer->data + y * comparison->buffer->width * pixel_size;
+			other_row = comparison->other->data + y * comparison->other->width * pixel_size;
+
+			/* Most rows of a regression image are identical, and memcmp is
+			about as fast as the memory bus allows. */
+			if (memcmp(row, other_row, comparison->width * pixel_size) == 0) continue;
+
+			row_count = 0;
+			for (bx = 0, x0 = 0; bx < comparison->blocks_across; bx++, x0 += DIFF_BLOCK) {
+				pixels = (x0 + DIFF_BLOCK > comparison->width) ?
+					comparison->width - x0 : DIFF_BLOCK;
+				if (memcmp(row + x0 * pixel_size, other_row + x0 * pixel_size,
+					pixels * pixel_size) == 0) continue;
+
+				row_count += Diff_segment(comparison, row + x0 * pixel_size,
+					other_row + x0 * pixel_size, x0, y, pixels,
+					comparison->blocks + band * comparison->blocks_across + bx);
+				}
+
+			if (max_diffs != 0 && row_count != 0 &&
+				atomic_fetch_add(&comparison->count, row_count) + row_count >= max_diffs)
+				atomic_store(&comparison->stop, true);
+			}
+		}
+
+	return NULL;
+	}
+
+/* Compare one block-wide segment of a row. */
+static size_t Diff_segment(struct Comparison *comparison,
+	const uint8_t *segment, const uint8_t *other_segment, const size_t x0,
+	const size_t y, const size_t pixels, struct Block *block) {
+	const size_t channels = comparison->options->channels; /* channels per pixel */
+	uint8_t exceeds[DIFF_BLOCK * DIFF_MAX_CHANNELS]; /* per-channel flags */
+	size_t count = 0; /* differing pixels in the segment */
+	size_t p; /* current pixel */
+	size_t c; /* current channel */
+	bool differs; /* whether or not the current pixel differs */
+
+	switch (comparison->options->channel_size) {
+		case 1:
+			Diff_exceeds8(segment, other_segment, comparison->tolerance8,
+				pixels * channels, exceeds);
+			break;
+		case 2:
+			Diff_exceeds16((const uint16_t*) segment, (const uint16_t*) other_segment,
+				comparison->tolerance16, pixels * channels, exceeds);
+			break;
+		case 4:
+			Diff_exceeds32((const uint32_t*) segment, (const uint32_t*) other_segment,
+				comparison->tolerance32, pixels * channels, exceeds);
+			break;
+		}
+
+	for (p = 0; p < pixels; p++) {
+		differs = false;
+		for (c = 0; c < channels; c++) differs |= exceeds[p * channels + c];
+		if (! differs) continue;
+
+		/* Rows are visited in order within a band, so only the first
+		difference sets ymin. */
+		if (block->count == 0) {
+			block->xmin = block->xmax = x0 + p;
+			block->ymin = y;
+			}
+		if (x0 + p < block->xmin) block->xmin = x0 + p;
+		if (x0 + p > block->xmax) block->xmax = x0 + p;
+		block->ymax = y;
+		block->count++;
+		count++;
+		}
+
+	return count;
+	}
+
+/* Flag every 1-byte channel whose difference exceeds its tolerance. */
+static void Diff_exceeds8(const uint8_t *a, const uint8_t *b,
+	const uint8_t *tolerance, const size_t n, uint8_t *exceeds) {
+	size_t i; /* current channel */
+
+	for (i = 0; i < n; i++)
+		exceeds[i] = ((a[i] > b[i]) ? a[i] - b[i] : b[i] - a[i]) > tolerance[i];
+	}
+
+/* Flag every 2-byte channel whose difference exceeds its tolerance. */
+static void Diff_exceeds16(const uint16_t *a, const uint16_t *b,
+	const uint16_t *tolerance, const size_t n, uint8_t *exceeds) {
+	size_t i; /* current channel */
+
+	for (i = 0; i < n; i++)
+		exceeds[i] = ((a[i] > b[i]) ? a[i] - b[i] : b[i] - a[i]) > tolerance[i];
+	}
+
+/* Flag every 4-byte channel whose difference exceeds its tolerance. */
+static void Diff_exceeds32(const uint32_t *a, const uint32_t *b,
+	const uint32_t *tolerance, const size_t n, uint8_t *exceeds) {
+	size_t i; /* current channel */
+
+	for (i = 0; i < n; i++)
+		exceeds[i] = ((a[i] > b[i]) ? a[i] - b[i] : b[i] - a[i]) > tolerance[i];
+	}
+
+/* Merge the differing blocks into 8-connected regions. */
+static bool Diff_findRegions(const struct Comparison *comparison, Diff_T diff) {
+	const size_t across = comparison->blocks_across; /* blocks in each band */
+	const size_t block_count = across * comparison->blocks_down; /* blocks */
+	size_t *parents; /* parent of each block in the union-find forest */
+	size_t *region_of; /* region of each root block */
+	const struct Block *block; /* current block */
+	struct DiffRegion *region; /* region of the current block */
+	size_t index; /* current block index */
+	size_t root; /* root of the current block */
+	size_t neighbor; /* index of a neighboring block */
+	size_t bx; /* column of the current block */
+	size_t by; /* band of the current block */
+
+	parents = (size_t*) malloc(sizeof(size_t) * (2 * block_count + 1));
+	if (parents == NULL) return false;
+	region_of = parents + block_count;
+
+	for (index = 0; index < block_count; index++) {
+		parents[index] = index;
+		region_of[index] = NO_REGION;
+		}
+
+	/* Join each differing block to the differing blocks before it (left,
+	and the three above); that covers all 8 neighbors once. */
+	for (index = 0; index < block_count; index++) {
+		if (comparison->blocks[index].count == 0) continue;
+		bx = index % across;
+		by = index / across;
+
+		if (bx > 0 && comparison->blocks[index - 1].count != 0)
+			parents[Diff_findRoot(parents, index - 1)] = Diff_findRoot(parents, index);
+		if (by == 0) continue;
+		for (neighbor = index - across - (bx > 0); neighbor <= index - across + 1 &&
+			neighbor < by * across; neighbor++) {
+			if (comparison->blocks[neighbor].count != 0)
+				parents[Diff_findRoot(parents, neighbor)] = Diff_findRoot(parents, index);
+			}
+		}
+
+	/* There can be no more regions than differing blocks. */
+	diff->region_count = 0;
+	for (index = 0; index < block_count; index++)
+		if (comparison->blocks[index].count != 0) diff->region_count++;
+
+	diff->regions = (struct DiffRegion*) malloc(
+		sizeof(struct DiffRegion) * (diff->region_count + 1));
+	if (diff->regions == NULL) {
+		free(parents);
+		return false;
+		}
+
+	diff->region_count = 0;
+	for (index = 0; index < block_count; index++) {
+		block = comparison->blocks + index;
+		if (block->count == 0) continue;
+
+		root = Diff_findRoot(parents, index);
+		if (region_of[root] == NO_REGION) {
+			region_of[root] = diff->region_count++;
+			region = diff->regions + region_of[root];
+			region->x = block->xmin;
+			region->y = block->ymin;
+			region->width = block->xmax - block->xmin + 1;
+			region->height = block->ymax - block->ymin + 1;
+			region->count = block->count;
+			continue;
+			}
+
+		/* Grow the region's bounding box to cover the block. */
+		region = diff->regions + region_of[root];
+		if (block->xmin < region->x) {
+			region->width += region->x - block->xmin;
+			region->x = block->xmin;
+			}
+		if (block->ymin < region->y) {
+			region->height += region->y - block->ymin;
+			region->y = block->ymin;
+			}
+		if (block->xmax >= region->x + region->width)
+			region->width = block->xmax - region->x + 1;
+		if (block->ymax >= region->y + region->height)
+			region->height = block->ymax - region->y + 1;
+		region->count += block->count;
+		}
+
+	free(parents);
+	return true;
+	}
+
+/* Find the root of a block in the union-find forest. */
+static size_t Diff_findRoot(size_t *parents, size_t index) {
+	size_t root = index; /* root of the block */
+	size_t next; /* next block on the path to the root */
+
+	while (parents[root] != root) root = parents[root];
+
+	while (parents[index] != root) {
+		next = parents[index];
+		parents[index] = root;
+		index = next;
+		}
+
+	return root;
+	}
@@ -0,0 +1,113 @@
+/*
+* diff.h
+* Author: Rushy Panchal
+* Description: Compares two pixel buffers. Provides the Diff_T ADT, which holds
+*	the number of differing pixels and the bounding boxes of the regions
+*	they form. Buffers are compared in bands of rows across several threads,
+*	and identical rows are skipped with a single (vectorized) memcmp.
+*/
+
+#ifndef DIFF_INCLUDED
+#define DIFF_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define DIFF_MAX_CHANNELS 4
+
+typedef struct Diff *Diff_T;
+
+/* A buffer of pixels, stored in row-major order without padding. */
+struct DiffBuffer {
+	const uint8_t *data; /* first byte of the first row */
+	size_t width; /* width of the buffer, in pixels */
+	size_t height; /* height of the buffer, in pixels */
+	};
+
+/* How two buffers are compared. */
+struct DiffOptions {
+	size_t channels; /* channels per pixel (at most DIFF_MAX_CHANNELS) */
+	size_t channel_size; /* bytes per channel: 1, 2 or 4 (native endian) */
+	uint32_t tolerance[DIFF_MAX_CHANNELS]; /* largest difference per channel
+	that is not counted */
+	size_t max_diffs; /* stop after (about) this many differences, or 0 */
+	unsigned threads; /* number of threads, or 0 for one per processor */
+	};
+
+/* The bounding box of a connected region of differing pixels. */
+struct DiffRegion {
+	size_t x; /* leftmost column of the region */
+	size_t y; /* topmost row of the region */
+	size_t width; /* width of the region */
+	size_t height; /* height of the region */
+	size_t count; /* number of differing pixels in the region */
+	};
+
+/*
+* Set the options to an exact comparison of 8-bit RGB pixels.
+* Parameters
+*	struct DiffOptions *options - options to set
+*/
+void Diff_defaultOptions(struct DiffOptions *options);
+
+/*
+* Compare two buffers. Pixels outside of the overlap of the two buffers
+* are counted as differences, but are not part of any region.
+* Parameters
+*	const struct DiffBuffer *buffer - primary buffer
+*	const struct DiffBuffer *other - secondary buffer
+*	const struct DiffOptions *options - how to compare the buffers
+* Returns
+*	(Diff_T) result of the comparison (or NULL on memory exhaustion)
+*/
+Diff_T Diff_compare(const struct DiffBuffer *buffer,
+	const struct DiffBuffer *other, const struct DiffOptions *options);
+
+/*
+* Free the result of a comparison.
+* Parameters
+*	Diff_T diff - result to free
+*/
+void Diff_free(Diff_T diff);
+
+/*
+* Get the number of differing pixels. If the comparison stopped early, this
+* is at least max_diffs but not necessarily the total.
+* Parameters
+*	const Diff_T diff - result of the comparison
+* Returns
+*	(size_t) difference count
+*/
+size_t Diff_getCount(const Diff_T diff);
+
+/*
+* Check whether the comparison stopped early because of max_diffs.
+* Parameters
+*	const Diff_T diff - result of the comparison
+* Returns
+*	(bool) true if the comparison stopped early, false otherwise
+*/
+bool Diff_stoppedEarly(const Diff_T diff);
+
+/*
+* Get the number of regions of differing pixels.
+* Parameters
+*	const Diff_T diff - result of the comparison
+* Returns
+*	(size_t) region count
+*/
+size_t Diff_getRegionCount(const Diff_T diff);
+
+/*
+* Get a region of differing pixels. Regions are ordered by their first block,
+* top to bottom and then left to right.
+* Parameters
+*	const Diff_T diff - result of the comparison
+*	const size_t index - index of the region
+* Returns
+*	(const struct DiffRegion*) region
+*/
+const struct DiffRegion *Diff_getRegion(const Diff_T diff, const size_t index);
+
+#endif
@@ -0,0 +1,893 @@
+/*
+* farm.c
+* Author: Rushy Panchal
+* Description: Renders the Mandelbrot Set across several worker processes.
+*	A coordinator splits the image into tiles and hands them out, one at a
+*	time, to worker processes over local (UNIX domain) sockets. Workers that
+*	die or stall are replaced and their tiles re-issued. The results are
+*	assembled into one image and, optionally, a tile pyramid.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <getopt.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <assert.h>
+#include "image.h"
+#include "mandelbrot.h"
+#include "raw.h"
+#include "stats.h"
+
+#define DEFAULT_FILE "mandelbrot.png"
+#define DEFAULT_WIDTH 1000
+#define DEFAULT_HEIGHT 1000
+#define DEFAULT_ITERATIONS 100
+#define DEFAULT_EXPONENT 2
+#define DEFAULT_TILE_SIZE 128
+#define DEFAULT_TIMEOUT 30.0
+#define PYRAMID_TILE_SIZE 256
+#define MAX_WORKERS 256
+#define MAX_ATTEMPTS 5
+#define NO_TILE ((size_t) -1)
+
+/* Parameters of a render. Workers are forked from the coordinator, so they
+inherit the job (including the coordinate tables) rather than receive it. */
+struct Job {
+	size_t width; /* width of the image */
+	size_t height; /* height of the image */
+	unsigned long iterations; /* iterations per pixel */
+	unsigned long exponent; /* exponent for the set */
+	size_t tile_size; /* width and height of a (full) tile */
+	double *xs; /* x coordinate of each column */
+	double *ys; /* y coordinate of each row */
+	MandelbrotKernel kernel; /* kernel for the exponent */
+	};
+
+/* Faults to inject into workers, for testing re-issue. */
+struct Faults {
+	size_t crash_after; /* tiles before a worker dies (0 for never) */
+	size_t stall_after; /* tiles before a worker hangs (0 for never) */
+	};
+
+/* A tile request, sent from the coordinator to a worker. */
+struct TileRequest {
+	uint64_t tile; /* index of the tile */
+	uint64_t x0; /* leftmost column of the tile */
+	uint64_t y0; /* topmost row of the tile */
+	uint64_t width; /* width of the tile */
+	uint64_t height; /* height of the tile */
+	};
+
+/* A tile result, sent from a worker to the coordinator. It is followed by
+the draw flags of the tile, packed eight to a byte in row-major order. */
+struct TileResult {
+	uint64_t tile; /* index of the tile */
+	uint64_t iterations; /* total iterations executed */
+	};
+
+enum TileState { TILE_PENDING, TILE_ASSIGNED, TILE_DONE };
+
+/* A tile of the image, as tracked by the coordinator. */
+struct Tile {
+	size_t x0; /* leftmost column of the tile */
+	size_t y0; /* topmost row of the tile */
+	size_t width; /* width of the tile */
+	size_t height; /* height of the tile */
+	enum TileState state; /* progress of the tile */
+	unsigned attempts; /* number of times the tile was handed out */
+	};
+
+/* A worker process, as tracked by the coordinator. */
+struct Worker {
+	pid_t pid; /* process ID (or -1 if there is no process) */
+	int fd; /* coordinator's end of the socket (or -1) */
+	size_t tile; /* tile being rendered (or NO_TILE) */
+	double deadline; /* time by which the tile must be returned */
+	};
+
+/* A summary of a finished render. */
+struct Report {
+	size_t tile_count; /* number of tiles */
+	size_t reissued; /* number of tiles that were re-issued */
+	size_t spawned; /* number of worker processes started */
+	unsigned long long iterations; /* total iterations executed */
+	};
+
+/* A render in progress. */
+struct Coordinator {
+	const struct Job *job; /* parameters of the render */
+	const struct Faults *faults; /* faults to inject into workers */
+	Image_T image; /* image being assembled */
+	double timeout; /* seconds a worker may spend on one tile */
+	struct Tile *tiles; /* every tile of the image */
+	size_t tile_count; /* number of tiles */
+	size_t next_tile; /* next tile that has never been handed out */
+	size_t *retries; /* tiles to re-issue, as a stack */
+	size_t retry_count; /* number of tiles to re-issue */
+	size_t done; /* number of finished tiles */
+	struct Report report; /* summary of the render so far */
+	uint8_t *packed; /* buffer for the draw flags of a result */
+	struct Worker workers[MAX_WORKERS]; /* worker processes */
+	unsigned worker_count; /* number of worker slots */
+	};
+
+/* --- Internal Method Prototypes --- */
+/*
+* Render the job across worker processes, assembling the result into an image.
+* Parameters
+*	const struct Job *job - parameters of the render
+*	const unsigned workers - number of worker processes
+*	const double timeout - seconds a worker may spend on one tile
+*	const struct Faults *faults - faults to inject into workers
+*	Image_T image - (blank) image to draw into
+*	struct Report *report - summary to store the render in
+* Returns
+*	(bool) true on success, false on failure
+*/
+static bool farm_render(const struct Job *job, const unsigned workers,
+	const double timeout, const struct Faults *faults, Image_T image,
+	struct Report *report);
+
+/*
+* Start the worker process of a slot.
+* Parameters
+*	struct Coordinator *coordinator - render in progress
+*	const unsigned index - index of the worker slot
+* Returns
+*	(bool) true on success, false on failure
+*/
+static bool farm_spawn(struct Coordinator *coordinator, const unsigned index);
+
+/*
+* Kill and reap the worker process of a slot, if it has one.
+* Parameters
+*	struct Worker *worker - worker slot
+*/
+static void farm_stop(struct Worker *worker);
+
+/*
+* Queue the tile of a worker slot to be handed out again, if it has one.
+* Parameters
+*	struct Coordinator *coordinator - render in progress
+*	struct Worker *worker - worker slot
+*/
+static void farm_requeue(struct Coordinator *coordinator, struct Worker *worker);
+
+/*
+* Replace the worker process of a slot after it died, stalled or could not be
+* reached, and queue its tile to be re-issued.
+* Parameters
+*	struct Coordinator *coordinator - render in progress
+*	const unsigned index - index of the worker slot
+* Returns
+*	(bool) true on success, false if the tile has failed too often or no
+*		workers are left
+*/
+static bool farm_fail(struct Coordinator *coordinator, const unsigned index);
+
+/*
+* Hand the next tile to an idle worker, if there is one left.
+* Parameters
+*	struct Coordinator *coordinator - render in progress
+*	const unsigned index - index of the worker slot
+* Returns
+*	(bool) true on success, false if the worker could not be reached
+*/
+static bool farm_assign(struct Coordinator *coordinator, const unsigned index);
+
+/*
+* Receive a tile result from a worker and draw it into the image.
+* Parameters
+*	struct Coordinator *coordinator - render in progress
+*	const unsigned index - index of the worker slot
+* Returns
+*	(bool) true on success, false if the result could not be read
+*/
+static bool farm_receive(struct Coordinator *coordinator, const unsigned index);
+
+/*
+* Serve tile requests until the coordinator closes the socket.
+* Parameters
+*	const struct Job *job - parameters of the render
+*	const int fd - worker's end of the socket
+*	const struct Faults *faults - faults to inject
+*/
+static void farm_worker(const struct Job *job, const int fd,
+	const struct Faults *faults);
+
+/*
+* Read exactly size bytes from a file descriptor.
+* Parameters
+*	const int fd - file descriptor to read from
+*	void *buffer - buffer to read into
+*	size_t size - number of bytes to read
+* Returns
+*	(bool) true on success, false on error, timeout or end of file
+*/
+static bool read_full(const int fd, void *buffer, size_t size);
+
+/*
+* Write exactly size bytes to a file descriptor.
+* Parameters
+*	const int fd - file descriptor to write to
+*	const void *buffer - buffer to write from
+*	size_t size - number of bytes to write
+* Returns
+*	(bool) true on success, false on error
+*/
+static bool write_full(const int fd, const void *buffer, size_t size);
+
+/*
+* Save an image as a pyramid of PNG tiles. Level 0 is the full image, and
+* each following level halves the previous one until it fits in one tile.
+* Tiles are saved as dir/level/column_row.png.
+* Parameters
+*	const Image_T image - image to save
+*	const char *dir - directory to save the pyramid in
+* Returns
+*	(bool) true on success, false on failure
+*/
+static bool save_pyramid(const Image_T image, const char *dir);
+
+/*
+* Render the Mandelbrot Set across several worker processes, saving it to a file.
+* Command-Line Options
+*	-w, --workers N - number of worker processes (default: one per processor)
+*	-s, --tile-size N - width and height of a tile (default: 128; at most the
+*		larger side of the image)
+*	-t, --timeout SECONDS - time a worker may spend on one tile before it is
+*		considered stalled (default: 30)
+*	-p, --pyramid DIR - also save the image as a tile pyramid in DIR
+*	-S, --scaling - render with 1, 2, 4, ... workers up to --workers and
+*		report the throughput of each
+*	--crash-after N - (testing) each worker dies on its (N + 1)th tile
+*	--stall-after N - (testing) each worker hangs on its (N + 1)th tile
+* Command-Line Arguments
+*	char *path - path of the file to save the image to (default: mandelbrot.png);
+*		paths ending in .raw are saved as a raw buffer (see raw.h)
+*	size_t width - width of the image in pixels (default: 1000)
+*	size_t height - height of the image in pixels (default: 1000)
+*	unsigned long iterations - number of iterations to use per point (default: 100)
+*	unsigned long exponent - exponent of the Mandelbrot Set (default: 2)
+*/
+int main(int argc, char *argv[]) {
+	static const struct option long_options[] = {
+		{"workers", required_argument, NULL, 'w'},
+		{"tile-size", required_argument, NULL, 's'},
+		{"timeout", required_argument, NULL, 't'},
+		{"pyramid", required_argument, NULL, 'p'},
+		{"scaling", no_argument, NULL, 'S'},
+		{"crash-after", required_argument, NULL, 'C'},
+		{"stall-after", required_argument, NULL, 'T'},
+		{NULL, 0, NULL, 0}
+		};
+	char *path = DEFAULT_FILE; /* path of the file to save the image to */
+	size_t width = DEFAULT_WIDTH; /* width of the image */
+	size_t height = DEFAULT_HEIGHT; /* height of the image */
+	unsigned long iterations = DEFAULT_ITERATIONS; /* number of iterations
+	to use per point */
+	unsigned long exponent = DEFAULT_EXPONENT; /* exponent to use for
+	the Mandelbrot Set */
+	char *pyramid_dir = NULL; /* directory to save the pyramid in */
+	bool scaling = false; /* whether or not to report scaling */
+	unsigned workers; /* number of worker processes */
+	double timeout = DEFAULT_TIMEOUT; /* seconds allowed per tile */
+	struct Faults faults = {0, 0}; /* faults to inject into workers */
+	struct Job job; /* parameters of the render */
+	struct Report report; /* summary of the last render */
+	Image_T image = NULL; /* resulting image of Mandelbrot set */
+	unsigned count; /* number of workers of the current render */
+	double start_time; /* time the current render started */
+	double elapsed; /* wall time of the current render */
+	double base_time = 0; /* wall time with a single worker */
+	bool saved; /* whether or not the image was saved */
+	long cpus; /* number of online processors */
+	int option; /* current command-line option */
+
+	cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	workers = (cpus < 1) ? 1 : (cpus > MAX_WORKERS) ? MAX_WORKERS : (unsigned) cpus;
+	job.tile_size = DEFAULT_TILE_SIZE;
+
+	while ((option = getopt_long(argc, argv, "w:s:t:p:S", long_options, NULL)) != -1) {
+		switch (option) {
+			case 'w':
+				workers = (unsigned) strtoul(optarg, NULL, 0);
+				break;
+			case 's':
+				job.tile_size = (size_t) strtoul(optarg, NULL, 0);
+				break;
+			case 't':
+				timeout = strtod(optarg, NULL);
+				break;
+			case 'p':
+				pyramid_dir = optarg;
+				break;
+			case 'S':
+				scaling = true;
+				break;
+			case 'C':
+				faults.crash_after = (size_t) strtoul(optarg, NULL, 0);
+				break;
+			case 'T':
+				faults.stall_after = (size_t) strtoul(optarg, NULL, 0);
+				break;
+			default:
+				exit(EXIT_FAILURE);
+			}
+		}
+
+	/* There are no breaks (until the last case), as in mandelbrot.c. */
+	switch (argc - optind) {
+		case 5: /* exponent */
+			exponent = strtoul(argv[optind + 4], NULL, 0);
+		case 4: /* number of iterations */
+			iterations = strtoul(argv[optind + 3], NULL, 0);
+		case 3: /* height */
+			height = (size_t) strtoul(argv[optind + 2], NULL, 0);
+		case 2: /* width */
+			width = (size_t) strtoul(argv[optind + 1], NULL, 0);
+		case 1: /* path */
+			path = argv[optind];
+			break;
+		}
+
+	/* A tile never needs to be larger than the image. Every tile is
+	allocated at its full size, so its area must also fit in a size_t. */
+	if (job.tile_size > width && job.tile_size > height)
+		job.tile_size = (width > height) ? width : height;
+
+	if (workers < 1 || workers > MAX_WORKERS || job.tile_size == 0 ||
+		job.tile_size > SIZE_MAX / job.tile_size ||
+		timeout <= 0 || width == 0 || height == 0) {
+		fprintf(stderr, "Invalid configuration.\n");
+		exit(EXIT_FAILURE);
+		}
+
+	printf("Configuration\n\tFile: %s\n\tSize (Width x Height): %lu x %lu px\n\
+\tIterations: %lu\n\tExponent: %lu\n\tWorkers: %u\n\tTile Size: %lu px\n",
+		path, width, height, iterations, exponent, workers, job.tile_size);
+
+	job.width = width;
+	job.height = height;
+	job.iterations = iterations;
+	job.exponent = exponent;
+	job.xs = (double*) malloc(sizeof(double) * (width + height));
+	if (job.xs == NULL) {
+		fprintf(stderr, "Memory error when creating job.\n");
+		exit(EXIT_FAILURE);
+		}
+	job.ys = job.xs + width;
+	generate_mandelbrot_coordinates(width, height, MANDELBROT_XMIN,
+		MANDELBROT_XMAX, MANDELBROT_YMIN, MANDELBROT_YMAX, job.xs, job.ys);
+	job.kernel = generate_mandelbrot_kernel(exponent);
+
+	/* Writing to a worker that has just died must fail, not kill us. */
+	signal(SIGPIPE, SIG_IGN);
+
+	if (scaling) printf("Scaling\n\tWorkers\tTime (s)\tMpx/s\tSpeedup\tEfficiency\n");
+
+	/* Without --scaling, this runs once with every worker. */
+	for (count = scaling ? 1 : workers; count <= workers;
+		count = (count < workers && count * 2 > workers) ? workers : count * 2) {
+		Image_free(image);
+		image = Image_new(width, height);
+		if (image == NULL) {
+			fprintf(stderr, "Memory error when creating image.\n");
+			exit(EXIT_FAILURE);
+			}
+
+		start_time = Stats_now();
+		if (! farm_render(&job, count, timeout, &faults, image, &report)) {
+			fprintf(stderr, "Render failed.\n");
+			exit(EXIT_FAILURE);
+			}
+		elapsed = Stats_now() - start_time;
+		if (count == 1) base_time = elapsed;
+
+		if (scaling) {
+			printf("\t%u\t%f\t%.2f\t%.2f\t%.2f\n", count, elapsed,
+				width * height / elapsed / 1e6, base_time / elapsed,
+				base_time / elapsed / count);
+			}
+		else {
+			printf("Render\n\tTiles: %lu (%lu re-issued)\n\tWorkers Started: %lu\n\
+\tIterations: %llu\n\tTime: %f s\n\tThroughput: %.2f Mpx/s\n",
+				report.tile_count, report.reissued, report.spawned,
+				report.iterations, elapsed, width * height / elapsed / 1e6);
+			}
+
+		if (count == workers) break;
+		}
+
+	if (Raw_isRawPath(path))
+		saved = Image_saveRaw(image, path);
+	else saved = Image_save(image, path);
+	if (! saved) {
+		fprintf(stderr, "Error saving to file %s\n", path);
+		}
+	if (pyramid_dir != NULL && ! save_pyramid(image, pyramid_dir)) {
+		fprintf(stderr, "Error saving pyramid to %s\n", pyramid_dir);
+		}
+
+	Image_free(image);
+	free(job.xs);
+
+	return 0;
+	}
+
+/* --- Internal Methods --- */
+/* Render the job across worker processes. */
+static bool farm_render(const struct Job *job, const unsigned workers,
+	const double timeout, const struct Faults *faults, Image_T image,
+	struct Report *report) {
+	struct Coordinator coordinator; /* render in progress */
+	struct pollfd fds[MAX_WORKERS]; /* sockets to wait on */
+	unsigned slots[MAX_WORKERS]; /* worker slot of each socket */
+	nfds_t nfds; /* number of sockets to wait on */
+	size_t tiles_across; /* number of tiles in each row */
+	size_t index; /* current tile index */
+	unsigned i; /* current worker slot */
+	nfds_t f; /* current socket */
+	double now; /* current time */
+	double wait; /* seconds until the nearest deadline */
+	bool ok = true; /* whether or not the render is going well */
+
+	assert(workers > 0 && workers <= MAX_WORKERS);
+
+	memset(&coordinator, 0, sizeof(struct Coordinator));
+	coordinator.job = job;
+	coordinator.faults = faults;
+	coordinator.image = image;
+	coordinator.timeout = timeout;
+	coordinator.worker_count = workers;
+
+	tiles_across = (job->width + job->tile_size - 1) / job->tile_size;
+	coordinator.tile_count = tiles_across *
+		((job->height + job->tile_size - 1) / job->tile_size);
+	coordinator.report.tile_count = coordinator.tile_count;
+
+	coordinator.tiles = (struct Tile*) calloc(coordinator.tile_count, sizeof(struct Tile));
+	coordinator.retries = (size_t*) malloc(sizeof(size_t) * coordinator.tile_count);
+	coordinator.packed = (uint8_t*) malloc(
+		(job->tile_size * job->tile_size + 7) / 8);
+	if (coordinator.tiles == NULL || coordinator.retries == NULL ||
+		coordinator.packed == NULL) {
+		free(coordinator.tiles);
+		free(coordinator.retries);
+		free(coordinator.packed);
+		return false;
+		}
+
+	for (index = 0; index < coordinator.tile_count; index++) {
+		coordinator.tiles[index].x0 = (index % tiles_across) * job->tile_size;
+		coordinator.tiles[index].y0 = (index / tiles_across) * job->tile_size;
+		coordinator.tiles[index].width =
+			(coordinator.tiles[index].x0 + job->tile_size > job->width) ?
+			job->width - coordinator.tiles[index].x0 : job->tile_size;
+		coordinator.tiles[index].height =
+			(coordinator.tiles[index].y0 + job->tile_size > job->height) ?
+			job->height - coordinator.tiles[index].y0 : job->tile_size;
+		}
+
+	for (i = 0; i < workers; i++) {
+		coordinator.workers[i].pid = -1;
+		coordinator.workers[i].fd = -1;
+		coordinator.workers[i].tile = NO_TILE;
+		}
+
+	/* Start every worker; a worker that cannot be started is treated like
+	one that died. */
+	for (i = 0; i < workers && ok; i++)
+		if (! farm_spawn(&coordinator, i)) ok = farm_fail(&coordinator, i);
+
+	while (ok && coordinator.done < coordinator.tile_count) {
+		/* Keep every live worker busy. */
+		for (i = 0; i < workers && ok; i++) {
+			if (coordinator.workers[i].pid > 0 && coordinator.workers[i].tile == NO_TILE &&
+				! farm_assign(&coordinator, i)) ok = farm_fail(&coordinator, i);
+			}
+		if (! ok) break;
+
+		/* Wait on every busy worker, but no longer than the nearest deadline. */
+		now = Stats_now();
+		wait = timeout;
+		for (i = 0, nfds = 0; i < workers; i++) {
+			if (coordinator.workers[i].tile == NO_TILE) continue;
+			fds[nfds].fd = coordinator.workers[i].fd;
+			fds[nfds].events = POLLIN;
+			fds[nfds].revents = 0;
+			slots[nfds++] = i;
+			if (coordinator.workers[i].deadline - now < wait)
+				wait = coordinator.workers[i].deadline - now;
+			}
+
+		/* Every live worker was just given a tile, so this only happens if
+		there are none. */
+		if (nfds == 0) {
+			fprintf(stderr, "No workers are left.\n");
+			ok = false;
+			break;
+			}
+
+		if (poll(fds, nfds, (wait > 0) ? (int) (wait * 1000) + 1 : 0) < 0 &&
+			errno != EINTR) {
+			ok = false;
+			break;
+			}
+
+		now = Stats_now();
+		for (f = 0; f < nfds && ok; f++) {
+			i = slots[f];
+			if (fds[f].revents != 0) {
+				if (! farm_receive(&coordinator, i)) ok = farm_fail(&coordinator, i);
+				}
+			else if (now > coordinator.workers[i].deadline) {
+				fprintf(stderr, "Worker %d stalled; re-issuing its tile.\n",
+					(int) coordinator.workers[i].pid);
+				ok = farm_fail(&coordinator, i);
+				}
+			}
+		}
+
+	/* Closing the sockets tells idle workers to exit; busy ones (only left
+	after a failure) are killed. */
+	for (i = 0; i < workers; i++) {
+		if (coordinator.workers[i].fd >= 0) close(coordinator.workers[i].fd);
+		coordinator.workers[i].fd = -1;
+		if (coordinator.workers[i].tile != NO_TILE) farm_stop(coordinator.workers + i);
+		else if (coordinator.workers[i].pid > 0)
+			waitpid(coordinator.workers[i].pid, NULL, 0);
+		}
+
+	free(coordinator.tiles);
+	free(coordinator.retries);
+	free(coordinator.packed);
+	*report = coordinator.report;
+
+	return ok;
+	}
+
+/* Start the worker process of a slot. */
+static bool farm_spawn(struct Coordinator *coordinator, const unsigned index) {
+	struct Worker *worker = coordinator->workers + index; /* worker slot */
+	int fds[2]; /* both ends of the socket */
+	struct timeval limit; /* longest a single read may block */
+	unsigned i; /* current worker slot */
+	pid_t pid; /* process ID of the worker */
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return false;
+
+	fflush(stdout);
+	fflush(stderr);
+	pid = fork();
+	if (pid < 0) {
+		close(fds[0]);
+		close(fds[1]);
+		return false;
+		}
+
+	if (pid == 0) {
+		/* The worker must not hold the other workers' sockets open, or they
+		would never see the coordinator close them. */
+		for (i = 0; i < coordinator->worker_count; i++)
+			if (coordinator->workers[i].fd >= 0) close(coordinator->workers[i].fd);
+		close(fds[0]);
+
+		signal(SIGPIPE, SIG_DFL);
+		farm_worker(coordinator->job, fds[1], coordinator->faults);
+		_exit(0);
+		}
+
+	close(fds[1]);
+
+	/* A worker that stalls partway through a result must not hang us. */
+	limit.tv_sec = (time_t) coordinator->timeout;
+	limit.tv_usec = (suseconds_t) ((coordinator->timeout - limit.tv_sec) * 1e6);
+	setsockopt(fds[0], SOL_SOCKET, SO_RCVTIMEO, &limit, sizeof(limit));
+
+	worker->pid = pid;
+	worker->fd = fds[0];
+	worker->tile = NO_TILE;
+	coordinator->report.spawned++;
+
+	return true;
+	}
+
+/* Kill and reap the worker process of a slot. */
+static void farm_stop(struct Worker *worker) {
+	if (worker->fd >= 0) close(worker->fd);
+	if (worker->pid > 0) {
+		kill(worker->pid, SIGKILL);
+		waitpid(worker->pid, NULL, 0);
+		}
+	worker->fd = -1;
+	worker->pid = -1;
+	}
+
+/* Queue the tile of a worker slot to be handed out again. */
+static void farm_requeue(struct Coordinator *coordinator, struct Worker *worker) {
+	if (worker->tile == NO_TILE) return;
+
+	coordinator->tiles[worker->tile].state = TILE_PENDING;
+	coordinator->retries[coordinator->retry_count++] = worker->tile;
+	worker->tile = NO_TILE;
+	}
+
+/* Replace the worker process of a slot and queue its tile to be re-issued. */
+static bool farm_fail(struct Coordinator *coordinator, const unsigned index) {
+	struct Worker *worker = coordinator->workers + index; /* worker slot */
+	struct Tile *tile; /* tile the worker was rendering */
+	unsigned i; /* current worker slot */
+
+	farm_stop(worker);
+
+	if (worker->tile != NO_TILE) {
+		tile = coordinator->tiles + worker->tile;
+		if (tile->attempts >= MAX_ATTEMPTS) {
+			fprintf(stderr, "Tile at (%lu, %lu) failed %u times; giving up.\n",
+				tile->x0, tile->y0, tile->attempts);
+			return false;
+			}
+		farm_requeue(coordinator, worker);
+		coordinator->report.reissued++;
+		}
+
+	if (farm_spawn(coordinator, index)) {
+		if (farm_assign(coordinator, index)) return true;
+		farm_stop(worker);
+		farm_requeue(coordinator, worker);
+		}
+
+	/* The slot could not be refilled; carry on with the rest, as long as
+	there are any. */
+	for (i = 0; i < coordinator->worker_count; i++)
+		if (coordinator->workers[i].pid > 0) return true;
+
+	fprintf(stderr, "No workers are left.\n");
+	return false;
+	}
+
+/* Hand the next tile to an idle worker. */
+static bool farm_assign(struct Coordinator *coordinator, const unsigned index) {
+	struct Worker *worker = coordinator->workers + index; /* worker slot */
+	struct TileRequest request; /* request to send */
+	struct Tile *tile; /* tile to hand out */
+	size_t next; /* index of the tile to hand out */
+
+	assert(worker->tile == NO_TILE);
+
+	/* Tiles to re-issue go first, so that a failure does not leave a hole
+	at the end of the render. */
+	if (coordinator->retry_count > 0)
+		next = coordinator->retries[--coordinator->retry_count];
+	else if (coordinator->next_tile < coordinator->tile_count)
+		next = coordinator->next_tile++;
+	else return true;
+
+	tile = coordinator->tiles + next;
+	request.tile = next;
+	request.x0 = tile->x0;
+	request.y0 = tile->y0;
+	request.width = tile->width;
+	request.height = tile->height;
+
+	tile->state = TILE_ASSIGNED;
+	tile->attempts++;
+	worker->tile = next;
+	worker->deadline = Stats_now() + coordinator->timeout;
+
+	return write_full(worker->fd, &request, sizeof(request));
+	}
+
+/* Receive a tile result from a worker and draw it into the image. */
+static bool farm_receive(struct Coordinator *coordinator, const unsigned index) {
+	struct Worker *worker = coordinator->workers + index; /* worker slot */
+	struct TileResult result; /* result header */
+	struct Tile *tile; /* tile being received */
+	size_t pixel; /* current pixel of the tile */
+
+	if (worker->tile == NO_TILE) return false;
+	tile = coordinator->tiles + worker->tile;
+
+	if (! read_full(worker->fd, &result, sizeof(result)) ||
+		result.tile != worker->tile ||
+		! read_full(worker->fd, coordinator->packed,
+			(tile->width * tile->height + 7) / 8)) return false;
+
+	for (pixel = 0; pixel < tile->width * tile->height; pixel++) {
+		if (coordinator->packed[pixel / 8] & (1 << (pixel % 8))) {
+			Image_setPixel(coordinator->image, tile->x0 + pixel % tile->width,
+				tile->y0 + pixel / tile->width, 0, 0, 255);
+			}
+		}
+
+	tile->state = TILE_DONE;
+	coordinator->done++;
+	coordinator->report.iterations += result.iterations;
+	worker->tile = NO_TILE;
+
+	return true;
+	}
+
+/* Serve tile requests until the coordinator closes the socket. */
+static void farm_worker(const struct Job *job, const int fd,
+	const struct Faults *faults) {
+	struct TileRequest request; /* current request */
+	struct TileResult *result; /* result header, followed by the flags */
+	uint8_t *packed; /* packed draw flags of the result */
+	uint8_t *draw; /* draw flags of the current tile */
+	size_t packed_size; /* size of the packed draw flags */
+	size_t pixel; /* current pixel of the tile */
+	size_t handled = 0; /* number of tiles rendered */
+
+	draw = (uint8_t*) malloc(job->tile_size * job->tile_size);
+	result = (struct TileResult*) malloc(sizeof(struct TileResult) +
+		(job->tile_size * job->tile_size + 7) / 8);
+	if (draw == NULL || result == NULL) _exit(EXIT_FAILURE);
+	packed = (uint8_t*) (result + 1);
+
+	while (read_full(fd, &request, sizeof(request))) {
+		if (request.width > job->tile_size || request.height > job->tile_size ||
+			request.x0 + request.width > job->width ||
+			request.y0 + request.height > job->height) _exit(EXIT_FAILURE);
+
+		if (faults->crash_after != 0 && handled == faults->crash_after)
+			kill(getpid(), SIGKILL);
+		if (faults->stall_after != 0 && handled == faults->stall_after)
+			for (;;) pause();
+
+		result->tile = request.tile;
+		result->iterations = job->kernel(job->xs, job->ys, job->iterations,
+			job->exponent, MANDELBROT_RADIUS, request.x0, request.y0,
+			request.width, request.height, draw, NULL);
+
+		packed_size = (request.width * request.height + 7) / 8;
+		memset(packed, 0, packed_size);
+		for (pixel = 0; pixel < request.width * request.height; pixel++)
+			packed[pixel / 8] |= draw[pixel] << (pixel % 8);
+
+		if (! write_full(fd, result, sizeof(struct TileResult) + packed_size))
+			break;
+		handled++;
+		}
+
+	free(draw);
+	free(result);
+	close(fd);
+	}
+
+/* Read exactly size bytes from a file descriptor. */
+static bool read_full(const int fd, void *buffer, size_t size) {
+	uint8_t *position = (uint8_t*) buffer; /* next byte to read into */
+	ssize_t count; /* bytes read by the last call */
+
+	while (size > 0) {
+		count = read(fd, position, size);
+		if (count < 0 && errno == EINTR) continue;
+		if (count <= 0) return false;
+		position += count;
+		size -= (size_t) count;
+		}
+
+	return true;
+	}
+
+/* Write exactly size bytes to a file descriptor. */
+static bool write_full(const int fd, const void *buffer, size_t size) {
+	const uint8_t *position = (const uint8_t*) buffer; /* next byte to write */
+	ssize_t count; /* bytes written by the last call */
+
+	while (size > 0) {
+		count = write(fd, position, size);
+		if (count < 0 && errno == EINTR) continue;
+		if (count <= 0) return false;
+		position += count;
+		size -= (size_t) count;
+		}
+
+	return true;
+	}
+
+/* Save an image as a pyramid of PNG tiles. */
+static bool save_pyramid(const Image_T image, const char *dir) {
+	const Image_T *level_image = &image; /* image of the current level */
+	Image_T scaled = NULL; /* current level, if it is not the full image */
+	Image_T next; /* next (halved) level */
+	Image_T tile; /* current tile */
+	const uint8_t *pixels; /* pixels of the current level */
+	const uint8_t *pixel; /* current pixel */
+	char path[4096]; /* path of the current directory or tile */
+	unsigned level; /* current level */
+	size_t width; /* width of the current level */
+	size_t height; /* height of the current level */
+	size_t x0; /* leftmost column of the current tile */
+	size_t y0; /* topmost row of the current tile */
+	size_t w; /* iterating width */
+	size_t h; /* iterating height */
+	unsigned sum[3]; /* sum of the channels of a 2x2 square */
+	unsigned samples; /* number of pixels in the square */
+	size_t dx; /* column within the square */
+	size_t dy; /* row within the square */
+	size_t c; /* current channel */
+	bool ok = true; /* whether or not every tile was saved */
+
+	if (mkdir(dir, 0755) != 0 && errno != EEXIST) return false;
+
+	for (level = 0; ok; level++) {
+		width = Image_getWidth(*level_image);
+		height = Image_getHeight(*level_image);
+		pixels = Image_getPixels(*level_image);
+
+		snprintf(path, sizeof(path), "%s/%u", dir, level);
+		if (mkdir(path, 0755) != 0 && errno != EEXIST) ok = false;
+
+		for (y0 = 0; ok && y0 < height; y0 += PYRAMID_TILE_SIZE) {
+			for (x0 = 0; ok && x0 < width; x0 += PYRAMID_TILE_SIZE) {
+				tile = Image_new((x0 + PYRAMID_TILE_SIZE > width) ?
+					width - x0 : PYRAMID_TILE_SIZE, (y0 + PYRAMID_TILE_SIZE > height) ?
+					height - y0 : PYRAMID_TILE_SIZE);
+				if (tile == NULL) {
+					ok = false;
+					break;
+					}
+
+				for (h = 0; h < Image_getHeight(tile); h++) {
+					for (w = 0; w < Image_getWidth(tile); w++) {
+						pixel = pixels + 3 * ((y0 + h) * width + x0 + w);
+						Image_setPixel(tile, w, h, pixel[0], pixel[1], pixel[2]);
+						}
+					}
+
+				snprintf(path, sizeof(path), "%s/%u/%lu_%lu.png", dir, level,
+					x0 / PYRAMID_TILE_SIZE, y0 / PYRAMID_TILE_SIZE);
+				ok = Image_save(tile, path);
+				Image_free(tile);
+				}
+			}
+
+		if (! ok || (width <= PYRAMID_TILE_SIZE && height <= PYRAMID_TILE_SIZE))
+			break;
+
+		/* Halve the level, averaging each 2x2 square. */
+		next = Image_new((width + 1) / 2, (height + 1) / 2);
+		if (next == NULL) {
+			ok = false;
+			break;
+			}
+
+		for (h = 0; h < Image_getHeight(next); h++) {
+			for (w = 0; w < Image_getWidth(next); w++) {
+				sum[0] = sum[1] = sum[2] = 0;
+				samples = 0;
+				for (dy = 0; dy < 2 && 2 * h + dy < height; dy++) {
+					for (dx = 0; dx < 2 && 2 * w + dx < width; dx++) {
+						pixel = pixels + 3 * ((2 * h + dy) * width + 2 * w + dx);
+						for (c = 0; c < 3; c++) sum[c] += pixel[c];
+						samples++;
+						}
+					}
+				Image_setPixel(next, w, h, sum[0] / samples, sum[1] / samples,
+					sum[2] / samples);
+				}
+			}
+
+		Image_free(scaled);
+		scaled = next;
+		level_image = &scaled;
+		}
+
+	Image_free(scaled);
+	return ok;
+	}
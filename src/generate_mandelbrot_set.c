@@ -8,9 +8,58 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <pthread.h>
 #include <assert.h>
 #include "image.h"
 #include "mandelbrot.h"
+#include "topology.h"
+#include "placement.h"
+#ifdef STATS
+#include "stats.h"
+#endif
+
+#define TILE_SIZE 64
+#define MAX_THREADS 256
+#define PIXEL_SIZE 3
+
+/* Parameters shared by every tile of a render. */
+struct Plane {
+	size_t width; /* width of the image */
+	size_t height; /* height of the image */
+	unsigned long iterations; /* iterations per pixel */
+	unsigned long exponent; /* exponent for the set */
+	double *xs; /* x coordinate of each column */
+	double *ys; /* y coordinate of each row */
+	double radius; /* escape radius of the set */
+	MandelbrotKernel kernel; /* kernel for the exponent */
+	};
+
+/* A render in progress: the image and the placement of its pixels and
+tiles across memory nodes (see placement.h). */
+struct Render {
+	const struct Plane *plane; /* parameters of the render */
+	Image_T image; /* image being drawn */
+	size_t tiles_across; /* number of tiles in each row */
+	Topology_T topology; /* topology of the machine */
+	Placement_T placement; /* placement of the pixels and tiles */
+	unsigned touched; /* threads that have touched their share */
+	bool ready; /* whether or not every share has been touched */
+	pthread_mutex_t lock; /* protects touched and ready */
+	pthread_cond_t touched_cond; /* signalled as threads touch their share */
+#ifdef STATS
+	Stats_T stats; /* collector to record into (or NULL) */
+#endif
+	};
+
+/* A single rendering thread. */
+struct Worker {
+	struct Render *render; /* render being worked on */
+	unsigned id; /* index of the thread (see placement.h) */
+	pthread_t thread; /* underlying thread */
+	};
 
 /* --- Internal Method Prototypes --- */
 /*
@@ -26,71 +75,420 @@
 static inline void crpow(double *zreal,  double *zimag, unsigned long exp,
 	const double real_extra, const double imag_extra);
 
+/*
+* Render a single tile of the Mandelbrot Set with an exponent of 2. This is
+* generate_mandelbrot_tile with crpow unrolled, and gives identical results.
+* Parameters
+*	(see generate_mandelbrot_tile)
+* Returns
+*	(unsigned long long) total iterations executed
+*/
+static unsigned long long generate_mandelbrot_tile_quadratic(const double *xs,
+	const double *ys, const unsigned long iterations,
+	const unsigned long exponent, const double radius, const size_t x0,
+	const size_t y0, const size_t tile_width, const size_t tile_height,
+	uint8_t *draw, uint32_t *counts);
+
+/*
+* Pin the worker to its node, first touch its share of the image, wait until
+* every share is touched, and render.
+* Parameters
+*	void *arg - (struct Worker*) worker to render with
+* Returns
+*	(void*) NULL
+*/
+static void *render_worker(void *arg);
+
+/*
+* Render tiles until there are none left, starting with those held by the
+* worker's node.
+* Parameters
+*	struct Worker *worker - worker to render with
+*/
+static void render_tiles(struct Worker *worker);
+
 /* Generate the Mandelbrot Set and return an image. */
 Image_T generate_mandelbrot_set(const size_t width, const size_t height,
 	const unsigned long iterations, const unsigned long exponent,
 	const double xmin, const double xmax, const double ymin,
 	const double ymax, const double radius) {
 	Image_T image = NULL; /* resulting image */
+	struct Plane plane; /* parameters shared by every tile */
+	struct Render render; /* render in progress */
+	struct Worker workers[MAX_THREADS]; /* rendering threads */
+	unsigned threads; /* number of rendering threads */
+	unsigned started; /* number of threads started */
+	unsigned t; /* current thread */
+	size_t tile_count; /* total number of tiles */
+	long cpus; /* number of online processors */
+#ifdef STATS
+	double start_time; /* time the render started */
+#endif
+
+	assert(width >= 0);
+	assert(height >= 0);
+	assert(iterations >= 0);
+	assert(exponent >= 0);
+
+	/* The pixels are left untouched here, so that each node's share is
+	placed on it when its threads touch it. */
+	image = Image_newUnset(width, height);
+	if (image == NULL) {
+		fprintf(stderr, "Memory error when creating image.\n");
+		exit(EXIT_FAILURE);
+		}
+
+	plane.width = width;
+	plane.height = height;
+	plane.iterations = iterations;
+	plane.exponent = exponent;
+	plane.radius = radius;
+	plane.kernel = generate_mandelbrot_kernel(exponent);
+
+	plane.xs = (double*) malloc(sizeof(double) * (width + height + 1));
+	if (plane.xs == NULL) {
+		fprintf(stderr, "Memory error when creating image.\n");
+		exit(EXIT_FAILURE);
+		}
+	plane.ys = plane.xs + width;
+	generate_mandelbrot_coordinates(width, height, xmin, xmax, ymin, ymax,
+		plane.xs, plane.ys);
 
+	render.plane = &plane;
+	render.image = image;
+	render.tiles_across = (width + TILE_SIZE - 1) / TILE_SIZE;
+	tile_count = render.tiles_across * ((height + TILE_SIZE - 1) / TILE_SIZE);
+	render.topology = Topology_new(0);
+	if (render.topology == NULL) {
+		fprintf(stderr, "Memory error when creating image.\n");
+		exit(EXIT_FAILURE);
+		}
+	render.touched = 0;
+	render.ready = false;
+
+	/* One thread per processor, but no more threads than there are tiles. */
+	cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	threads = (cpus < 1) ? 1 : (cpus > MAX_THREADS) ? MAX_THREADS : (unsigned) cpus;
+	if (threads > tile_count) threads = tile_count;
+	if (threads == 0) threads = 1;
+
+	render.placement = Placement_new(render.topology, threads, width * height,
+		false);
+	if (render.placement == NULL) {
+		fprintf(stderr, "Memory error when creating image.\n");
+		exit(EXIT_FAILURE);
+		}
+	Placement_queueTiles(render.placement, width, height, TILE_SIZE);
+	pthread_mutex_init(&render.lock, NULL);
+	pthread_cond_init(&render.touched_cond, NULL);
+
+#ifdef STATS
+	render.stats = Stats_getActive();
+	if (render.stats != NULL &&
+		! Stats_beginRender(render.stats, width, height, TILE_SIZE, threads))
+		render.stats = NULL;
+	start_time = Stats_now();
+#endif
+
+	for (t = 0; t < threads; t++) {
+		workers[t].render = &render;
+		workers[t].id = t;
+		}
+
+	/* If a thread cannot be started, the calling thread touches its share
+	and the others pick up its tiles. */
+	for (t = 0; t < threads; t++) {
+		if (pthread_create(&workers[t].thread, NULL, render_worker,
+			workers + t) != 0) break;
+		}
+	started = t;
+	for (; t < threads; t++) {
+		Placement_touch(render.placement, t, Image_getMutablePixels(image),
+			Image_getSize(image) * PIXEL_SIZE);
+		}
+
+	/* No tile is rendered until every share has been placed. */
+	pthread_mutex_lock(&render.lock);
+	while (render.touched < started)
+		pthread_cond_wait(&render.touched_cond, &render.lock);
+	render.ready = true;
+	pthread_cond_broadcast(&render.touched_cond);
+	pthread_mutex_unlock(&render.lock);
+
+	if (started == 0) render_tiles(workers);
+	for (t = 0; t < started; t++) pthread_join(workers[t].thread, NULL);
+
+#ifdef STATS
+	if (render.stats != NULL) Stats_endRender(render.stats,
+		Stats_now() - start_time);
+#endif
+
+	pthread_cond_destroy(&render.touched_cond);
+	Placement_free(render.placement);
+	Topology_free(render.topology);
+	pthread_mutex_destroy(&render.lock);
+	free(plane.xs);
+	return image;
+	}
+
+/* Map each column and row of an image to its point in the xy-plane. */
+void generate_mandelbrot_coordinates(const size_t width, const size_t height,
+	const double xmin, const double xmax, const double ymin, const double ymax,
+	double *xs, double *ys) {
 	/* The scales are used to map each pixel to the appropriate Cartestian
 	coordinate. */
 	const double x_scale = (xmax - xmin) / width; /* scale of the x plane */
 	const double y_scale = (ymax - ymin) / height; /* scale of the y plane */
 
-	const double limit = radius * radius; /* radius squared avoids taking the
-	square root in abs(z). */
-
 	double x; /* x coordinate */
 	double y; /* y coordinate */
 	size_t w; /* iterating width */
 	size_t h; /* iterating height */
+
+	assert(xs != NULL);
+	assert(ys != NULL);
+
+	/* The coordinates are accumulated (rather than multiplied out per pixel)
+	so that they match exactly however the image is split up. As in the
+	original loop, the first row starts at ymax - x_scale (the x86 version
+	starts it at ymax - y_scale, so non-square images differ slightly). */
+	for (x = xmax - x_scale, w = width - 1; w != 0; x -= x_scale, w--) xs[w] = x;
+	for (y = ymax - x_scale, h = height - 1; h != 0; y -= y_scale, h--) ys[h] = y;
+	}
+
+/* Render a single tile of the Mandelbrot Set. */
+unsigned long long generate_mandelbrot_tile(const double *xs, const double *ys,
+	const unsigned long iterations, const unsigned long exponent,
+	const double radius, const size_t x0, const size_t y0,
+	const size_t tile_width, const size_t tile_height, uint8_t *draw,
+	uint32_t *counts) {
+	const double limit = radius * radius; /* radius squared avoids taking the
+	square root in abs(z). */
+	unsigned long long total = 0; /* total iterations executed */
+	double x; /* x coordinate */
+	double y; /* y coordinate */
+	size_t w; /* iterating width (within the image) */
+	size_t h; /* iterating height (within the image) */
 	double zreal; /* real part of the complex number */
 	double zimag; /* imaginary part of the complex number */
 	double distance_sqr; /* distance from origin squared */
 	unsigned long iter; /* current iteration */
-	bool draw; /* whether or not to draw the pixel */
 
-	assert(width >= 0);
-	assert(height >= 0);
-	assert(iterations >= 0);
-	assert(exponent >= 0);
+	for (h = y0; h < y0 + tile_height; h++) {
+		y = ys[h];
 
-	image = Image_new(width, height);
-	if (image == NULL) {
-		fprintf(stderr, "Memory error when creating image.\n");
-		exit(EXIT_FAILURE);
-		}
+		for (w = x0; w < x0 + tile_width; w++, draw++) {
+			/* The first row and column of the image are never drawn. */
+			if (w == 0 || h == 0) {
+				*draw = false;
+				if (counts != NULL) *counts++ = 0;
+				continue;
+				}
 
-	/* Iterate through the pixels in the image, mapping each to a single
-	point in the xy-plane. */
-	for (x = xmax - x_scale, w = width - 1; w != 0; x -= x_scale, w--) {
-		for (y = ymax - x_scale, h = height - 1; h != 0; y -= y_scale, h--) {
 			/* Convert the (x, y) coordinate to a complex number. */
+			x = xs[w];
 			zreal = x;
 			zimag = y;
 
-			draw = true;
 			/* Iterate the function z^exponent + c as long as it stays within
 			the given limit. */
-
 			for (iter = iterations; iter > 0; iter--) {
 				crpow(&zreal, &zimag, exponent, x, y);
 
 				/* If it passes the limit, do not draw the point. Also, no need
 				to iterate further as any further iterations will also pass the limit. */
 				distance_sqr = (zreal * zreal + zimag * zimag);
-				if (distance_sqr > limit || distance_sqr < 0) {
-					draw = false;
-					break;
+				if (distance_sqr > limit || distance_sqr < 0) break;
+				}
+
+			/* The loop only runs to completion if the point never escaped;
+			otherwise, the iteration it escaped on also counts. */
+			if (iter == 0) {
+				*draw = true;
+				total += iterations;
+				if (counts != NULL) *counts++ = (uint32_t) iterations;
+				}
+			else {
+				*draw = false;
+				total += iterations - iter + 1;
+				if (counts != NULL) *counts++ = (uint32_t) (iterations - iter + 1);
+				}
+			}
+		}
+
+	return total;
+	}
+
+/* Select the kernel to render tiles with. */
+MandelbrotKernel generate_mandelbrot_kernel(const unsigned long exponent) {
+	if (exponent == 2) return generate_mandelbrot_tile_quadratic;
+	return generate_mandelbrot_tile;
+	}
+
+/* --- Internal Methods --- */
+/* Pin the worker to its node, touch its share of the image, and render. */
+static void *render_worker(void *arg) {
+	struct Worker *worker = (struct Worker*) arg; /* this worker */
+	struct Render *render = worker->render; /* render being worked on */
+
+	/* If pinning fails, the worker still runs (just unpinned). */
+	Topology_bind(render->topology,
+		Placement_getNode(render->placement, worker->id));
+	Placement_touch(render->placement, worker->id,
+		Image_getMutablePixels(render->image), Image_getSize(render->image) *
+		PIXEL_SIZE);
+
+	pthread_mutex_lock(&render->lock);
+	render->touched++;
+	pthread_cond_broadcast(&render->touched_cond);
+	while (! render->ready) pthread_cond_wait(&render->touched_cond, &render->lock);
+	pthread_mutex_unlock(&render->lock);
+
+	render_tiles(worker);
+	return NULL;
+	}
+
+/* Render tiles until there are none left. */
+static void render_tiles(struct Worker *worker) {
+	struct Render *render = worker->render; /* render being worked on */
+	const struct Plane *plane = render->plane; /* parameters of the render */
+	uint8_t draw[TILE_SIZE * TILE_SIZE]; /* draw flags of the current tile */
+	size_t tile; /* current tile */
+	size_t x0; /* leftmost column of the tile */
+	size_t y0; /* topmost row of the tile */
+	size_t tile_width; /* width of the tile */
+	size_t tile_height; /* height of the tile */
+	size_t w; /* iterating width (within the tile) */
+	size_t h; /* iterating height (within the tile) */
+	uint8_t *flag; /* current draw flag */
+#ifdef STATS
+	struct TileStats *tile_stats; /* statistics of the current tile */
+	struct ThreadStats *thread_stats = NULL; /* statistics of this thread */
+	unsigned long long tile_iterations; /* iterations of the current tile */
+	size_t drawn; /* pixels drawn in the current tile */
+	size_t skipped; /* pixels of the current tile that were never iterated */
+	double start_time; /* start of the current phase */
+	double escape_end; /* end of the escape loop phase */
+	double draw_end; /* end of the drawing phase */
+
+	if (render->stats != NULL)
+		thread_stats = Stats_thread(render->stats, worker->id);
+#endif
+
+	while (Placement_nextTile(render->placement, worker->id, &tile)) {
+		x0 = (tile % render->tiles_across) * TILE_SIZE;
+		y0 = (tile / render->tiles_across) * TILE_SIZE;
+		tile_width = (x0 + TILE_SIZE > plane->width) ? plane->width - x0 : TILE_SIZE;
+		tile_height = (y0 + TILE_SIZE > plane->height) ? plane->height - y0 : TILE_SIZE;
+
+#ifdef STATS
+		start_time = Stats_now();
+		tile_iterations = plane->kernel(plane->xs, plane->ys,
+			plane->iterations, plane->exponent, plane->radius, x0, y0,
+			tile_width, tile_height, draw, NULL);
+		escape_end = Stats_now();
+		drawn = 0;
+#else
+		plane->kernel(plane->xs, plane->ys, plane->iterations,
+			plane->exponent, plane->radius, x0, y0, tile_width, tile_height,
+			draw, NULL);
+#endif
+
+		/* Drawing is kept out of the escape loop so that the two can be
+		timed separately (and so that the loop stays free of calls). */
+		for (h = 0, flag = draw; h < tile_height; h++) {
+			for (w = 0; w < tile_width; w++, flag++) {
+				if (*flag) {
+					Image_setPixel(render->image, x0 + w, y0 + h, 0, 0, 255);
+#ifdef STATS
+					drawn++;
+#endif
 					}
 				}
+			}
 
-			if (draw) Image_setPixel(image, w, h, 0, 0, 255);
+#ifdef STATS
+		if (thread_stats != NULL) {
+			draw_end = Stats_now();
+			tile_stats = Stats_tile(render->stats, tile);
+			tile_stats->thread = worker->id;
+			tile_stats->iterations = tile_iterations;
+			/* The kernels skip the image's first row and column, so those
+			pixels neither escaped nor ran every iteration. */
+			skipped = ((y0 == 0) ? tile_width : 0) + ((x0 == 0) ? tile_height : 0) -
+				((x0 == 0 && y0 == 0) ? 1 : 0);
+			tile_stats->maxed = drawn;
+			tile_stats->skipped = skipped;
+			tile_stats->escaped = tile_width * tile_height - drawn - skipped;
+			tile_stats->escape_time = escape_end - start_time;
+			tile_stats->draw_time = draw_end - escape_end;
+			thread_stats->tiles++;
+			thread_stats->busy_time += draw_end - start_time;
 			}
+#endif
 		}
+	}
 
-	return image;
+/* Render a single tile of the Mandelbrot Set with an exponent of 2. */
+static unsigned long long generate_mandelbrot_tile_quadratic(const double *xs,
+	const double *ys, const unsigned long iterations,
+	const unsigned long exponent, const double radius, const size_t x0,
+	const size_t y0, const size_t tile_width, const size_t tile_height,
+	uint8_t *draw, uint32_t *counts) {
+	const double limit = radius * radius; /* radius squared avoids taking the
+	square root in abs(z). */
+	unsigned long long total = 0; /* total iterations executed */
+	double x; /* x coordinate */
+	double y; /* y coordinate */
+	size_t w; /* iterating width (within the image) */
+	size_t h; /* iterating height (within the image) */
+	double zreal; /* real part of the complex number */
+	double zimag; /* imaginary part of the complex number */
+	double wreal; /* real part of z^2 */
+	double distance_sqr; /* distance from origin squared */
+	unsigned long iter; /* current iteration */
+
+	assert(exponent == 2);
+
+	for (h = y0; h < y0 + tile_height; h++) {
+		y = ys[h];
+
+		for (w = x0; w < x0 + tile_width; w++, draw++) {
+			/* The first row and column of the image are never drawn. */
+			if (w == 0 || h == 0) {
+				*draw = false;
+				if (counts != NULL) *counts++ = 0;
+				continue;
+				}
+
+			x = xs[w];
+			zreal = x;
+			zimag = y;
+
+			/* Same operations, in the same order, as crpow with exp = 2. */
+			for (iter = iterations; iter > 0; iter--) {
+				wreal = zreal * zreal - zimag * zimag;
+				zimag = (zreal * zimag + zimag * zreal) + y;
+				zreal = wreal + x;
+
+				distance_sqr = (zreal * zreal + zimag * zimag);
+				if (distance_sqr > limit || distance_sqr < 0) break;
+				}
+
+			if (iter == 0) {
+				*draw = true;
+				total += iterations;
+				if (counts != NULL) *counts++ = (uint32_t) iterations;
+				}
+			else {
+				*draw = false;
+				total += iterations - iter + 1;
+				if (counts != NULL) *counts++ = (uint32_t) (iterations - iter + 1);
+				}
+			}
+		}
+
+	return total;
 	}
 
 /* Raise a complex number to a real power and add extra real/imaginary parts
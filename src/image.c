@@ -11,8 +11,12 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include <assert.h>
 #include "image.h"
+#include "diff.h"
+#include "raw.h"
 
 #define DEPTH 8
 #define PIXEL_SIZE 3
@@ -43,16 +47,6 @@ struct Image {
 static struct Pixel *Image_pixel(const Image_T image, const size_t row,
 	const size_t col);
 
-/*
-* Free the PNG rows.
-* Parameters
-*	png_structp png - png struct to free from
-*	png_byte **rows - rows to free
-*	const size_t count - number of rows
-*/
-static void Image_freePngRows(png_structp png, png_byte **rows,
-	const size_t count);
-
 /* Create a new image of the requested width and height. */
 Image_T Image_new(const size_t width, const size_t height) {
 	Image_T image; /* image for client */
@@ -78,6 +72,39 @@ Image_T Image_new(const size_t width, const size_t height) {
 	return image;
 	}
 
+/* Create a new image whose pixels are left unset. */
+Image_T Image_newUnset(const size_t width, const size_t height) {
+	Image_T image; /* image for client */
+	long page_size; /* size of a memory page */
+	size_t size; /* size of the pixels, in bytes */
+
+	assert(width >= 0);
+	assert(height >= 0);
+
+	if (height != 0 && width > SIZE_MAX / sizeof(struct Pixel) / height) return NULL;
+	size = sizeof(struct Pixel) * width * height;
+
+	image = (Image_T) malloc(sizeof(struct Image));
+	if (image == NULL) return NULL;
+
+	page_size = sysconf(_SC_PAGESIZE);
+	if (posix_memalign((void**) &image->pixels, (page_size > 0) ? (size_t) page_size :
+		4096, (size != 0) ? size : 1) != 0) {
+		free(image);
+		return NULL;
+		}
+
+#ifdef MADV_NOHUGEPAGE
+	/* A huge page would be placed whole by its first writer. */
+	if (size != 0) madvise(image->pixels, size, MADV_NOHUGEPAGE);
+#endif
+
+	image->width = width;
+	image->height = height;
+
+	return image;
+	}
+
 /* Create an image from a file.*/
 Image_T Image_fromFile(const char *path) {
 	Image_T image = NULL; /* image to return to client */
@@ -87,11 +114,9 @@ Image_T Image_fromFile(const char *path) {
 	size_t width; /* width of the image */
 	size_t height;  /* height of the image */
 	png_byte color_type; /* type of the color */
+	png_byte bit_depth; /* bits per channel */
 	png_byte **row_pointers = NULL; /* png byte data */
-	png_byte *row = NULL; /* single row in PNG file */
 	size_t h; /* current iterating height */
-	size_t w; /* current iterating width */
-	struct Pixel *pixel; /* current iterating pixel */
 
 	assert(path != NULL);
 
@@ -129,8 +154,30 @@ Image_T Image_fromFile(const char *path) {
 	width = (size_t) png_get_image_width(png, png_info);
 	height = (size_t) png_get_image_height(png, png_info);
 	color_type = png_get_color_type(png, png_info);
+	bit_depth = png_get_bit_depth(png, png_info);
+
+	/* Have libpng convert whatever is in the file to 8-bit RGB, which is
+	the layout of the pixels in memory. */
+	if (bit_depth == 16) png_set_strip_16(png);
+	if (color_type == PNG_COLOR_TYPE_PALETTE) png_set_palette_to_rgb(png);
+	if (color_type == PNG_COLOR_TYPE_GRAY && bit_depth < 8)
+		png_set_expand_gray_1_2_4_to_8(png);
+	if (color_type == PNG_COLOR_TYPE_GRAY ||
+		color_type == PNG_COLOR_TYPE_GRAY_ALPHA) png_set_gray_to_rgb(png);
+	/* A palette with transparency is expanded to RGBA, so it loses its alpha
+	channel too. */
+	if ((color_type & PNG_COLOR_MASK_ALPHA) ||
+		png_get_valid(png, png_info, PNG_INFO_tRNS)) png_set_strip_alpha(png);
 	png_read_update_info(png, png_info);
 
+	/* The rows are decoded straight into the image, so reject any file whose
+	rows did not come out as 8-bit RGB. */
+	if (png_get_rowbytes(png, png_info) != width * sizeof(struct Pixel)) {
+		fclose(fp);
+		png_destroy_read_struct(&png, &png_info, NULL);
+		return NULL;
+		}
+
 	/* Create the image. */
 	image = Image_new(width, height);
 	if (image == NULL) {
@@ -139,7 +186,8 @@ Image_T Image_fromFile(const char *path) {
 		return NULL;
 		}
 
-	/* Allocate memory for the data rows. */
+	/* The pixels are stored in row-major order with the same layout as a
+	PNG row, so the rows can be decoded directly into the image. */
 	row_pointers = (png_byte**) png_malloc(png, height * sizeof(png_byte*));
 	if (row_pointers == NULL) {
 		fclose(fp);
@@ -148,34 +196,24 @@ Image_T Image_fromFile(const char *path) {
 		return NULL;
 		}
 
-	for (h = 0; h < height; h++) {
-		row = png_malloc(png, sizeof(uint8_t) * width * PIXEL_SIZE);
-		if (row == NULL) {
-			fclose(fp);
-			Image_freePngRows(png, row_pointers, h);
-			png_destroy_read_struct(&png, &png_info, NULL);
-			Image_free(image);
-			return  NULL;
-			}
-		row_pointers[h] = row;
+	for (h = 0; h < height; h++)
+		row_pointers[h] = (png_byte*) (image->pixels + h * width);
+
+	/* Error handling, now that there is more to clean up. */
+	if (setjmp(png_jmpbuf(png))) {
+		fclose(fp);
+		png_free(png, row_pointers);
+		png_destroy_read_struct(&png, &png_info, NULL);
+		Image_free(image);
+		return NULL;
 		}
 
 	/* Read the image into memory. */
 	png_read_image(png, row_pointers);
 	fclose(fp);
 
-	/* Store the appropriate pixel data in the image. */
-	for (h = 0; h < height; h++) {
-		row = row_pointers[h];
-		for (w = 0; w < width; w++) {
-			pixel = Image_pixel(image, w, h);
-			pixel->red = *row++;
-			pixel->green = *row++;
-			pixel->blue = *row++;
-			}
-		}
-
-	Image_freePngRows(png, row_pointers, height);
+	png_free(png, row_pointers);
+	png_destroy_read_struct(&png, &png_info, NULL);
 	return image;
 	}
 
@@ -206,14 +244,28 @@ size_t Image_getSize(const Image_T image) {
 	return image->width * image->height;
 	}
 
+/* Get the pixels of an image. */
+const uint8_t *Image_getPixels(const Image_T image) {
+	assert(image != NULL);
+
+	return (const uint8_t*) image->pixels;
+	}
+
+/* Get the pixels of an image for writing in place. */
+uint8_t *Image_getMutablePixels(const Image_T image) {
+	assert(image != NULL);
+
+	return (uint8_t*) image->pixels;
+	}
+
 /* Set the RGB color of the pixel in the image. */
 void Image_setPixel(const Image_T image, const size_t row, const size_t col,
 	const uint8_t red, const uint8_t green, const uint8_t blue) {
 	struct Pixel *pixel = NULL; /* pixel at (row, col) */
 
 	assert(image != NULL);
-	assert(row >= 0 && row < image->height);
-	assert(col >= 0 && col < image->width);
+	assert(row >= 0 && row < image->width);
+	assert(col >= 0 && col < image->height);
 
 	pixel = Image_pixel(image, row, col);
 
@@ -224,16 +276,23 @@ void Image_setPixel(const Image_T image, const size_t row, const size_t col,
 
 /* Save the image at the file path. */
 bool Image_save(const Image_T image, const char *path) {
+	assert(image != NULL);
+	assert(path != NULL);
+
+	return Image_savePixels((const uint8_t*) image->pixels, image->width,
+		image->height, path);
+	}
+
+/* Save a buffer of RGB pixels at the file path. */
+bool Image_savePixels(const uint8_t *pixels, const size_t width,
+	const size_t height, const char *path) {
 	FILE *fp; /* file pointer to save the image */
 	png_structp png = NULL; /* PNG image struct */
 	png_infop png_info = NULL; /* PNG image info struct */
-	size_t w; /* width iterating index */
 	size_t h; /* height iterating index */
 	png_byte **row_pointers = NULL; /* png byte data */
-	png_byte *row = NULL; /* single row in PNG file */
-	struct Pixel *pixel = NULL; /* current pixel */
 
-	assert(image != NULL);
+	assert(pixels != NULL);
 	assert(path != NULL);
 
 	/* Open the file for writing in binary mode. */
@@ -266,8 +325,8 @@ bool Image_save(const Image_T image, const char *path) {
 	png_set_IHDR(
 		png,
 		png_info,
-		image->width,
-		image->height,
+		width,
+		height,
 		DEPTH,
 		PNG_COLOR_TYPE_RGB,
 		PNG_INTERLACE_NONE,
@@ -275,30 +334,24 @@ bool Image_save(const Image_T image, const char *path) {
 		PNG_FILTER_TYPE_DEFAULT);
 
 	/* Allocate memory for the data rows. */
-	row_pointers = (png_byte**) png_malloc(png, image->height * sizeof(png_byte*));
+	row_pointers = (png_byte**) png_malloc(png, height * sizeof(png_byte*));
 	if (row_pointers == NULL) {
 		fclose(fp);
 		png_destroy_write_struct(&png, &png_info);
 		return false;
 		}
 
-	/* Set the data in each row. */
-	for (h = 0; h < image->height; h++) {
-		row = png_malloc(png, sizeof(uint8_t) * image->width * PIXEL_SIZE);
-		if (row == NULL) {
-			fclose(fp);
-			Image_freePngRows(png, row_pointers, h);
-			png_destroy_write_struct(&png, &png_info);
-			return false;
-			}
-
-		row_pointers[h] = row;
-		for (w = 0; w < image->width; w++) {
-			pixel = Image_pixel(image, w, h);
-			*row++ = pixel->red;
-			*row++ = pixel->green;
-			*row++ = pixel->blue;
-			}
+	/* The pixels already have the layout of PNG rows, so each row can be
+	written straight from the buffer. */
+	for (h = 0; h < height; h++)
+		row_pointers[h] = (png_byte*) (pixels + h * width * PIXEL_SIZE);
+
+	/* Error handling, now that there is more to clean up. */
+	if (setjmp(png_jmpbuf(png))) {
+		fclose(fp);
+		png_free(png, row_pointers);
+		png_destroy_write_struct(&png, &png_info);
+		return false;
 		}
 
 	/* Set the rows, initialize I/O, and write the image to the file. */
@@ -307,43 +360,46 @@ bool Image_save(const Image_T image, const char *path) {
 	png_write_png(png, png_info, PNG_TRANSFORM_IDENTITY, NULL);
 
 	/* Free all resources used. */
-	Image_freePngRows(png, row_pointers, image->height);
+	png_free(png, row_pointers);
 	png_destroy_write_struct(&png, &png_info);
 	fclose(fp);
 
 	return true;
 	}
 
+/* Save the image as a raw buffer. */
+bool Image_saveRaw(const Image_T image, const char *path) {
+	assert(image != NULL);
+	assert(path != NULL);
+
+	return Raw_save(path, image->pixels, image->width, image->height,
+		PIXEL_SIZE, sizeof(uint8_t));
+	}
+
 /* Count the number of differences in the images. */
 size_t Image_diff(const Image_T image, const Image_T other) {
+	struct DiffBuffer buffer; /* pixels of the image */
+	struct DiffBuffer other_buffer; /* pixels of the other image */
+	struct DiffOptions options; /* exact comparison of RGB pixels */
+	Diff_T diff; /* result of the comparison */
 	size_t count; /* difference count */
-	size_t width; /* width to iterate */
-	size_t height; /* height to iterate */
-	size_t w; /* current iterating width */
-	size_t h; /* current iterating height */
-	struct Pixel *pixel; /* current pixel of the image */
-	struct Pixel *other_pixel; /* current pixel of the other image */
 
 	assert(image != NULL);
 	assert(other != NULL);
 
-	/* Take the smaller of the two widths and heights. */
-	width = (image->width > other->width) ? other->width: image->width;
-	height = (image->height > other->height) ? other->height: image->height;
-
-	/* Start the count off as the difference in sizes. */
-	count = image->width * image->height - other->width * other->height;
+	buffer.data = (const uint8_t*) image->pixels;
+	buffer.width = image->width;
+	buffer.height = image->height;
+	other_buffer.data = (const uint8_t*) other->pixels;
+	other_buffer.width = other->width;
+	other_buffer.height = other->height;
+	Diff_defaultOptions(&options);
 
-	for (h = 0; h < height; h++) {
-		for (w = 0; w < width; w++) {
-			pixel = Image_pixel(image, w, h);
-			other_pixel = Image_pixel(other, w, h);
+	diff = Diff_compare(&buffer, &other_buffer, &options);
+	if (diff == NULL) return (size_t) -1;
 
-			if (pixel->red != other_pixel->red ||
-				pixel->green != other_pixel->green ||
-				pixel->blue != other_pixel->blue) count++;
-			}
-		}
+	count = Diff_getCount(diff);
+	Diff_free(diff);
 
 	return count;
 	}
@@ -353,23 +409,8 @@ size_t Image_diff(const Image_T image, const Image_T other) {
 static struct Pixel *Image_pixel(const Image_T image, const size_t row,
 	const size_t col) {
 	assert(image != NULL);
-	assert(row >= 0 && row < image->height);
-	assert(col >= 0 && col < image->width);
+	assert(row >= 0 && row < image->width);
+	assert(col >= 0 && col < image->height);
 
 	return image->pixels + image->width * col + row;
 	}
-
-/* Free the PNG rows. */
-static void Image_freePngRows(png_structp png, png_byte **rows,
-	const size_t count) {
-	size_t iteration; /* iteration count */
-
-	assert(png != NULL);
-	assert(rows != NULL);
-	assert(count >= 0);
-
-	for (iteration = 0; iteration < count; iteration++)
-		png_free(png, rows[iteration]);
-
-	png_free(png, rows);
-	}
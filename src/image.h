@@ -10,6 +10,7 @@
 #define IMAGE_INCLUDED
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 typedef struct Image *Image_T;
@@ -24,6 +25,19 @@ typedef struct Image *Image_T;
 */
 Image_T Image_new(const size_t width, const size_t height);
 
+/*
+* Create a new image whose pixels are left unset, for callers that set every
+* pixel. The pixels are page-aligned, kept off huge pages and never touched
+* here, so each page is placed on the memory node of the thread that first
+* writes to it (see placement.h).
+* Parameters
+*	const size_t width - width of the image
+*	const size_t height - height of the image
+* Returns
+*	(Image_T) pointer to the Image object (or NULL on memory exhaustion)
+*/
+Image_T Image_newUnset(const size_t width, const size_t height);
+
 /*
 * Create an image from a file.
 * Parameters
@@ -67,6 +81,25 @@ size_t Image_getHeight(const Image_T image);
 */
 size_t Image_getSize(const Image_T image);
 
+/*
+* Get the pixels of an image, as 8-bit RGB triples in row-major order.
+* Parameters
+*	const Image_T image - image to get pixels of
+* Returns
+*	(const uint8_t*) pixels of the image
+*/
+const uint8_t *Image_getPixels(const Image_T image);
+
+/*
+* Get the pixels of an image for writing in place, as 8-bit RGB triples in
+* row-major order.
+* Parameters
+*	const Image_T image - image to get pixels of
+* Returns
+*	(uint8_t*) pixels of the image
+*/
+uint8_t *Image_getMutablePixels(const Image_T image);
+
 /*
 * Set the RGB color of the pixel in the image.
 * Parameters
@@ -82,12 +115,13 @@ void Image_setPixel(const Image_T image, const size_t row, const size_t col,
 
 /*
 * Calculate the difference of the two images. The returned value is
-* the number of differences detected.
+* the number of differences detected, including every pixel that is in
+* only one of the images. See diff.h for tolerances and regions.
 * Parameters
 *	const Image_T image - primary image
 *	const Image_T other - secondary image
 * Returns
-*	(size_t) difference count
+*	(size_t) difference count (or (size_t) -1 on memory exhaustion)
 */
 size_t Image_diff(const Image_T image, const Image_T other);
 
@@ -101,4 +135,28 @@ size_t Image_diff(const Image_T image, const Image_T other);
 */
 bool Image_save(const Image_T image, const char *path);
 
+/*
+* Save a buffer of pixels to a file as a PNG image.
+* Parameters
+*	const uint8_t *pixels - 8-bit RGB triples, in row-major order
+*	const size_t width - width of the buffer
+*	const size_t height - height of the buffer
+*	const char *path - path of the file to save the image to
+* Returns
+*	(bool) true on success, false on failure
+*/
+bool Image_savePixels(const uint8_t *pixels, const size_t width,
+	const size_t height, const char *path);
+
+/*
+* Save the image to a raw buffer file (see raw.h), which can be compared
+* without decoding.
+* Parameters
+*	const Image_t image - image to save
+*	const char *path - path of the file to save the image to
+* Returns
+*	(bool) true on success, false on failure
+*/
+bool Image_saveRaw(const Image_T image, const char *path);
+
 #endif
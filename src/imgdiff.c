@@ -7,36 +7,228 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <getopt.h>
 #include "image.h"
+#include "diff.h"
+#include "raw.h"
+
+/* An image loaded from either a PNG or a raw buffer file. */
+struct Source {
+	Image_T image; /* decoded PNG (or NULL) */
+	Raw_T raw; /* mapped raw buffer (or NULL) */
+	struct DiffBuffer buffer; /* pixels of the image */
+	size_t channels; /* channels per pixel */
+	size_t channel_size; /* bytes per channel */
+	};
+
+/* --- Internal Method Prototypes --- */
+/*
+* Load an image, mapping it directly if it is a raw buffer and decoding it
+* otherwise.
+* Parameters
+*	const char *path - path of the image
+*	struct Source *source - source to load the image into
+* Returns
+*	(bool) true on success, false on failure
+*/
+static bool load_source(const char *path, struct Source *source);
+
+/*
+* Free a loaded image.
+* Parameters
+*	struct Source *source - source to free
+*/
+static void free_source(struct Source *source);
+
+/*
+* Parse a comma-separated list of per-channel tolerances. A single value
+* applies to every channel.
+* Parameters
+*	const char *list - list to parse
+*	uint32_t *tolerance - (DIFF_MAX_CHANNELS) tolerances to store into
+* Returns
+*	(bool) true on success, false on failure
+*/
+static bool parse_tolerance(const char *list, uint32_t *tolerance);
 
 /*
 * Calculate the difference between two images.
+* Command-Line Options
+*	-t, --tolerance N[,N...] - largest per-channel difference that is not
+*		counted (default: 0)
+*	-m, --max-diffs N - stop once N differences are found (default: no limit)
+*	-r, --regions - print the bounding box of every region of differences
+*	-j, --threads N - number of threads (default: one per processor)
 * Command-Line Arguments
 *	char *path - path of the primary image
 *	char *other_path - path of the secondary image
+*
+* Note:
+*	Either image can be a PNG or a raw buffer (see raw.h); raw buffers are
+*	compared without decoding, and two raw buffers of any channel layout
+*	(such as iteration counts) can be compared as long as the layouts match.
 */
 int main(int argc, char *argv[]) {
-	Image_T image; /* primary image */
-	Image_T other_image; /* other image */
-	size_t diff; /* image difference */
+	static const struct option long_options[] = {
+		{"tolerance", required_argument, NULL, 't'},
+		{"max-diffs", required_argument, NULL, 'm'},
+		{"regions", no_argument, NULL, 'r'},
+		{"threads", required_argument, NULL, 'j'},
+		{NULL, 0, NULL, 0}
+		};
+	struct Source source; /* primary image */
+	struct Source other_source; /* other image */
+	struct DiffOptions options; /* how to compare the images */
+	bool show_regions = false; /* whether or not to print the regions */
+	Diff_T diff; /* result of the comparison */
+	const struct DiffRegion *region; /* current region */
+	size_t count; /* image difference */
+	size_t index; /* current region index */
 	double ratio_image; /* image diff to size ratio */
 	double ratio_other_image; /* other_image diff to size ratio */
+	int option; /* current command-line option */
+
+	Diff_defaultOptions(&options);
 
-	if (argc != 3) {
+	while ((option = getopt_long(argc, argv, "t:m:rj:", long_options, NULL)) != -1) {
+		switch (option) {
+			case 't':
+				if (! parse_tolerance(optarg, options.tolerance)) {
+					fprintf(stderr, "Invalid tolerance %s\n", optarg);
+					exit(EXIT_FAILURE);
+					}
+				break;
+			case 'm':
+				options.max_diffs = (size_t) strtoul(optarg, NULL, 0);
+				break;
+			case 'r':
+				show_regions = true;
+				break;
+			case 'j':
+				options.threads = (unsigned) strtoul(optarg, NULL, 0);
+				break;
+			default:
+				exit(EXIT_FAILURE);
+			}
+		}
+
+	if (argc - optind != 2) {
 		fprintf(stderr, "imgdiff expects exactly two command-line arguments.\n");
 		exit(EXIT_FAILURE);
 		}
 
-	image = Image_fromFile(argv[1]);
-	other_image = Image_fromFile(argv[2]);
+	if (! load_source(argv[optind], &source)) {
+		fprintf(stderr, "Error reading image %s\n", argv[optind]);
+		exit(EXIT_FAILURE);
+		}
+	if (! load_source(argv[optind + 1], &other_source)) {
+		fprintf(stderr, "Error reading image %s\n", argv[optind + 1]);
+		free_source(&source);
+		exit(EXIT_FAILURE);
+		}
 
-	diff = Image_diff(image, other_image);
-	ratio_image = (double) diff / Image_getSize(image);
-	ratio_other_image = (double) diff / Image_getSize(other_image);
+	if (source.channels != other_source.channels ||
+		source.channel_size != other_source.channel_size ||
+		source.channels > DIFF_MAX_CHANNELS ||
+		(source.channel_size != 1 && source.channel_size != 2 &&
+		source.channel_size != 4)) {
+		fprintf(stderr, "Images have incompatible pixel layouts.\n");
+		free_source(&source);
+		free_source(&other_source);
+		exit(EXIT_FAILURE);
+		}
+	options.channels = source.channels;
+	options.channel_size = source.channel_size;
 
-	printf("Difference\n\tCount: %lu\n\tPrimary Ratio: %f\n\t\
-Secondary Ratio: %f\n", diff, ratio_image, ratio_other_image);
+	diff = Diff_compare(&source.buffer, &other_source.buffer, &options);
+	if (diff == NULL) {
+		fprintf(stderr, "Memory error when comparing images.\n");
+		free_source(&source);
+		free_source(&other_source);
+		exit(EXIT_FAILURE);
+		}
 
-	if (diff == 0) return 0;
+	count = Diff_getCount(diff);
+	ratio_image = (double) count / (source.buffer.width * source.buffer.height);
+	ratio_other_image = (double) count /
+		(other_source.buffer.width * other_source.buffer.height);
+
+	printf("Difference\n\tCount: %lu%s\n\tPrimary Ratio: %f\n\t\
+Secondary Ratio: %f\n", count, Diff_stoppedEarly(diff) ? " (stopped early)" : "",
+		ratio_image, ratio_other_image);
+	printf("\tRegions: %lu\n", Diff_getRegionCount(diff));
+
+	if (show_regions) {
+		for (index = 0; index < Diff_getRegionCount(diff); index++) {
+			region = Diff_getRegion(diff, index);
+			printf("\t\t(%lu, %lu) %lu x %lu px: %lu\n", region->x, region->y,
+				region->width, region->height, region->count);
+			}
+		}
+
+	Diff_free(diff);
+	free_source(&source);
+	free_source(&other_source);
+
+	if (count == 0) return 0;
 	else return EXIT_FAILURE;
 	}
+
+/* --- Internal Methods --- */
+/* Load an image from a PNG or raw buffer file. */
+static bool load_source(const char *path, struct Source *source) {
+	memset(source, 0, sizeof(struct Source));
+
+	source->raw = Raw_open(path);
+	if (source->raw != NULL) {
+		source->buffer.data = Raw_getData(source->raw);
+		source->buffer.width = Raw_getWidth(source->raw);
+		source->buffer.height = Raw_getHeight(source->raw);
+		source->channels = Raw_getChannels(source->raw);
+		source->channel_size = Raw_getChannelSize(source->raw);
+		return true;
+		}
+
+	source->image = Image_fromFile(path);
+	if (source->image == NULL) return false;
+
+	source->buffer.data = Image_getPixels(source->image);
+	source->buffer.width = Image_getWidth(source->image);
+	source->buffer.height = Image_getHeight(source->image);
+	source->channels = 3;
+	source->channel_size = sizeof(uint8_t);
+	return true;
+	}
+
+/* Free a loaded image. */
+static void free_source(struct Source *source) {
+	Image_free(source->image);
+	Raw_close(source->raw);
+	}
+
+/* Parse a comma-separated list of per-channel tolerances. */
+static bool parse_tolerance(const char *list, uint32_t *tolerance) {
+	char *end; /* end of the current value */
+	size_t c = 0; /* current channel */
+	unsigned long value; /* current value */
+
+	do {
+		if (c == DIFF_MAX_CHANNELS) return false;
+		value = strtoul(list, &end, 0);
+		if (end == list || value > UINT32_MAX) return false;
+		tolerance[c++] = (uint32_t) value;
+		list = end + 1;
+		} while (*end == ',');
+
+	if (*end != '\0') return false;
+
+	/* A single value applies to every channel. */
+	if (c == 1) {
+		for (; c < DIFF_MAX_CHANNELS; c++) tolerance[c] = tolerance[0];
+		}
+
+	return true;
+	}
@@ -9,15 +9,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stddef.h>
+#include <string.h>
 #include <assert.h>
 #include "image.h"
 #include "mandelbrot.h"
+#include "raw.h"
+#ifdef STATS
+#include "stats.h"
+#endif
 
-#define XMIN -2.0f
-#define XMAX 2.0f
-#define YMIN -2.0f
-#define YMAX 2.0f
-#define LIMIT 2.0f
 #define DEFAULT_FILE "mandelbrot.png"
 #define DEFAULT_WIDTH 1000
 #define DEFAULT_HEIGHT 1000
@@ -27,11 +27,16 @@
 /*
 * Generate the Mandelbrot Set with the given settings, saving it to a file.
 * Command-Line Arguments
-*	char *path - path of the file to save the image to (default: mandelbrot.png)
+*	char *path - path of the file to save the image to (default: mandelbrot.png);
+*		paths ending in .raw are saved as a raw buffer (see raw.h)
 *	size_t width - width of the image in pixels (default: 1000)
 *	size_t height - height of the image in pixels (default: 1000)
 *	unsigned long iterations - number of iterations to use per point (default: 100)
 *	unsigned long exponent - exponent of the Mandelbrot Set (default: 2)
+*	char *stats_path - path of the file to write render statistics to, as JSON
+*		(default: none; requires a build with STATS, see `make stats`)
+*	char *heatmap_path - path of the file to save a per-tile iteration heatmap
+*		to (default: none; requires a build with STATS)
 *
 * Note:
 *	width and height should be even - they are made even if not provided as such.
@@ -46,13 +51,25 @@ int main(int argc, char *argv[]) {
 	unsigned long exponent = DEFAULT_EXPONENT; /* exponent to use for
 	the Mandelbrot Set */
 
+	char *stats_path = NULL; /* path of the file to write statistics to */
+	char *heatmap_path = NULL; /* path of the file to save the heatmap to */
+	bool saved; /* whether or not the image was saved */
+
 	Image_T image = NULL; /* resulting image of Mandelbrot set. */
+#ifdef STATS
+	Stats_T stats = NULL; /* statistics of the render */
+	double start_time; /* time saving the image started */
+#endif
 
 	/* There are no breaks (until the last case) because if argc = n,
 	we also want to run the (n - w) case for w in {0, n - 1} as all of those
 	arguments also need to be processed - they are present in the command-line
 	arguments. */
 	switch (argc) {
+		case 8: /* argv[7] is the heatmap path */
+			heatmap_path = argv[7];
+		case 7: /* argv[6] is the statistics path */
+			stats_path = argv[6];
 		case 6: /* argv[5] is the exponent */
 			exponent = strtoul(argv[5], NULL, 0);
 		case 5: /* argv[4] is the number of iterations */
@@ -80,13 +97,48 @@ int main(int argc, char *argv[]) {
 \tIterations: %lu\n\tExponent: %lu\n",
 		path, width, height, iterations, exponent);
 
+#ifdef STATS
+	if (stats_path != NULL || heatmap_path != NULL) {
+		stats = Stats_new();
+		if (stats == NULL) fprintf(stderr, "Memory error when creating statistics.\n");
+		Stats_setActive(stats);
+		}
+#else
+	if (stats_path != NULL || heatmap_path != NULL) {
+		fprintf(stderr, "Statistics are not compiled in; build with `make stats`.\n");
+		}
+#endif
+
 	/* Generate the Mandelbrot Set and try to save it to a file. */
 	image = generate_mandelbrot_set(width, height, iterations, exponent,
-		XMIN, XMAX, YMIN, YMAX, LIMIT);
-	if (! Image_save(image, path)) {
+		MANDELBROT_XMIN, MANDELBROT_XMAX, MANDELBROT_YMIN, MANDELBROT_YMAX,
+		MANDELBROT_RADIUS);
+#ifdef STATS
+	start_time = Stats_now();
+#endif
+	if (Raw_isRawPath(path))
+		saved = Image_saveRaw(image, path);
+	else saved = Image_save(image, path);
+#ifdef STATS
+	/* Taken before the image is freed, so only the save is timed. */
+	if (stats != NULL) Stats_setSaveTime(stats, Stats_now() - start_time);
+#endif
+	if (! saved) {
 		fprintf(stderr, "Error saving to file %s\n", path);
 		}
 	Image_free(image);
 
+#ifdef STATS
+	if (stats != NULL) {
+		if (stats_path != NULL && ! Stats_writeJson(stats, stats_path)) {
+			fprintf(stderr, "Error writing statistics to file %s\n", stats_path);
+			}
+		if (heatmap_path != NULL && ! Stats_saveHeatmap(stats, heatmap_path)) {
+			fprintf(stderr, "Error saving heatmap to file %s\n", heatmap_path);
+			}
+		Stats_free(stats);
+		}
+#endif
+
 	return 0;
 	}
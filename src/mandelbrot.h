@@ -4,6 +4,27 @@
 * Description: Interface to generate_mandelbrot.c. 
 */
 
+#ifndef MANDELBROT_INCLUDED
+#define MANDELBROT_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include "image.h"
+
+/* The default plane of the Mandelbrot Set, and its escape radius. */
+#define MANDELBROT_XMIN -2.0f
+#define MANDELBROT_XMAX 2.0f
+#define MANDELBROT_YMIN -2.0f
+#define MANDELBROT_YMAX 2.0f
+#define MANDELBROT_RADIUS 2.0f
+
+/* A function that renders a single tile (see generate_mandelbrot_tile). */
+typedef unsigned long long (*MandelbrotKernel)(const double *xs,
+	const double *ys, const unsigned long iterations,
+	const unsigned long exponent, const double radius, const size_t x0,
+	const size_t y0, const size_t tile_width, const size_t tile_height,
+	uint8_t *draw, uint32_t *counts);
+
 /*
 * Generate the Mandelbrot Set and return an image.
 * Parameters
@@ -23,3 +44,59 @@ Image_T generate_mandelbrot_set(const size_t width, const size_t height,
 	const unsigned long iterations, const unsigned long exponent,
 	const double xmin, const double xmax, const double ymin,
 	const double ymax, const double radius);
+
+/*
+* Map each column and row of an image to its point in the xy-plane. The first
+* column and row are never drawn, and are left unset.
+* Parameters
+*	const size_t width - width of the image
+*	const size_t height - height of the image
+*	const double xmin - minimum x value of the graph
+*	const double xmax - maximum x value of the graph
+*	const double ymin - minimum y value of the graph
+*	const double ymax - maximum y value of the graph
+*	double *xs - (width) x coordinate of each column
+*	double *ys - (height) y coordinate of each row
+*/
+void generate_mandelbrot_coordinates(const size_t width, const size_t height,
+	const double xmin, const double xmax, const double ymin, const double ymax,
+	double *xs, double *ys);
+
+/*
+* Render a single tile of the Mandelbrot Set, storing whether or not each
+* pixel should be drawn (and, optionally, how many iterations it ran). Tiles
+* rendered separately match the corresponding pixels of generate_mandelbrot_set
+* exactly. This is the generic kernel; see generate_mandelbrot_kernel.
+* Parameters
+*	const double *xs - x coordinate of each column (see above)
+*	const double *ys - y coordinate of each row (see above)
+*	const unsigned long iterations - iterations per pixel
+*	const unsigned long exponent - exponent for the set
+*	const double radius - escape radius of the set
+*	const size_t x0 - leftmost column of the tile
+*	const size_t y0 - topmost row of the tile
+*	const size_t tile_width - width of the tile
+*	const size_t tile_height - height of the tile
+*	uint8_t *draw - (tile_width * tile_height) flags, in row-major order
+*	uint32_t *counts - (tile_width * tile_height) iterations run by each
+*		pixel, in row-major order (or NULL)
+* Returns
+*	(unsigned long long) total iterations executed
+*/
+unsigned long long generate_mandelbrot_tile(const double *xs, const double *ys,
+	const unsigned long iterations, const unsigned long exponent,
+	const double radius, const size_t x0, const size_t y0,
+	const size_t tile_width, const size_t tile_height, uint8_t *draw,
+	uint32_t *counts);
+
+/*
+* Select the fastest kernel for an exponent. Every kernel takes the same
+* parameters as (and gives results identical to) generate_mandelbrot_tile.
+* Parameters
+*	const unsigned long exponent - exponent for the set
+* Returns
+*	(MandelbrotKernel) kernel to render tiles with
+*/
+MandelbrotKernel generate_mandelbrot_kernel(const unsigned long exponent);
+
+#endif
@@ -0,0 +1,236 @@
+/*
+* numa.c
+* Author: Rushy Panchal
+* Description: Benchmarks the placement of the render buffers across memory
+*	nodes. Renders the Mandelbrot Set with node-local buffers and with
+*	interleaved buffers, reports the time of each, and checks that both
+*	produce the same image. On a single-node machine, a two-node topology is
+*	simulated so that both placements are still exercised.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <getopt.h>
+#include "mandelbrot.h"
+#include "renderer.h"
+#include "topology.h"
+#include "stats.h"
+
+#define DEFAULT_WIDTH 4000
+#define DEFAULT_HEIGHT 4000
+#define DEFAULT_ITERATIONS 100
+#define DEFAULT_EXPONENT 2
+#define DEFAULT_REPEAT 5
+#define SIMULATED_NODES 2
+#define PLACEMENTS 2
+
+/* Timings of one placement. */
+struct Timing {
+	double setup; /* time to create the renderer (including first touch) */
+	double best; /* fastest render */
+	double mean; /* mean render */
+	size_t remote_tiles; /* tiles rendered off their node (last render) */
+	};
+
+/* --- Internal Method Prototypes --- */
+/*
+* Create a renderer with the given placement and render with it repeatedly.
+* Parameters
+*	const struct RendererParams *params - parameters of the render
+*	struct RendererOptions *options - options of the renderer
+*	const unsigned repeat - number of renders
+*	struct Timing *timing - timings to fill in
+*	Renderer_T *renderer - where to store the renderer (holding the last render)
+* Returns
+*	(enum RendererError) RENDERER_OK on success, an error code otherwise
+*/
+static enum RendererError benchmark(const struct RendererParams *params,
+	struct RendererOptions *options, const unsigned repeat,
+	struct Timing *timing, Renderer_T *renderer);
+
+/*
+* Compare node-local and interleaved placement of the render buffers.
+* Command-Line Options
+*	-j, --threads N - number of rendering threads (default: one per processor)
+*	-n, --nodes N - number of nodes to simulate (default: detect them, or
+*		simulate two if there is only one)
+*	-r, --repeat N - number of renders per placement (default: 5)
+*	-o, --output PATH - save the node-local render to PATH
+* Command-Line Arguments
+*	size_t width - width of the image in pixels (default: 4000)
+*	size_t height - height of the image in pixels (default: 4000)
+*	unsigned long iterations - number of iterations to use per point (default: 100)
+*	unsigned long exponent - exponent of the Mandelbrot Set (default: 2)
+*/
+int main(int argc, char *argv[]) {
+	static const struct option long_options[] = {
+		{"threads", required_argument, NULL, 'j'},
+		{"nodes", required_argument, NULL, 'n'},
+		{"repeat", required_argument, NULL, 'r'},
+		{"output", required_argument, NULL, 'o'},
+		{NULL, 0, NULL, 0}
+		};
+	static const char *names[PLACEMENTS] = {"local", "interleaved"}; /* names
+	of the placements */
+	static const enum RendererPlacement placements[PLACEMENTS] = {
+		RENDERER_PLACEMENT_LOCAL, RENDERER_PLACEMENT_INTERLEAVED
+		}; /* placements to compare */
+	struct RendererParams params = {DEFAULT_WIDTH, DEFAULT_HEIGHT,
+		DEFAULT_ITERATIONS, DEFAULT_EXPONENT, MANDELBROT_XMIN, MANDELBROT_XMAX,
+		MANDELBROT_YMIN, MANDELBROT_YMAX, MANDELBROT_RADIUS}; /* parameters of
+	the render */
+	struct RendererOptions options; /* options of the renderers */
+	struct Timing timings[PLACEMENTS]; /* timings of each placement */
+	Renderer_T renderers[PLACEMENTS] = {NULL, NULL}; /* renderer of each placement */
+	Topology_T topology; /* topology of the machine */
+	unsigned repeat = DEFAULT_REPEAT; /* number of renders per placement */
+	char *output = NULL; /* path to save the node-local render to */
+	enum RendererError error; /* result of the current operation */
+	bool identical; /* whether or not the placements rendered the same image */
+	unsigned p; /* current placement */
+	unsigned n; /* current node */
+	int option; /* current command-line option */
+
+	Renderer_defaultOptions(&options);
+
+	while ((option = getopt_long(argc, argv, "j:n:r:o:", long_options, NULL)) != -1) {
+		switch (option) {
+			case 'j':
+				options.threads = (unsigned) strtoul(optarg, NULL, 0);
+				break;
+			case 'n':
+				options.nodes = (unsigned) strtoul(optarg, NULL, 0);
+				break;
+			case 'r':
+				repeat = (unsigned) strtoul(optarg, NULL, 0);
+				break;
+			case 'o':
+				output = optarg;
+				break;
+			default:
+				exit(EXIT_FAILURE);
+			}
+		}
+
+	/* There are no breaks (until the last case), as in mandelbrot.c. */
+	switch (argc - optind) {
+		case 4: /* exponent */
+			params.exponent = strtoul(argv[optind + 3], NULL, 0);
+		case 3: /* number of iterations */
+			params.iterations = strtoul(argv[optind + 2], NULL, 0);
+		case 2: /* height */
+			params.height = (size_t) strtoul(argv[optind + 1], NULL, 0);
+		case 1: /* width */
+			params.width = (size_t) strtoul(argv[optind], NULL, 0);
+			break;
+		}
+
+	if (repeat == 0 || params.width == 0 || params.height == 0) {
+		fprintf(stderr, "Invalid configuration.\n");
+		exit(EXIT_FAILURE);
+		}
+
+	/* With a single node, both placements would be the same. */
+	topology = Topology_new(options.nodes);
+	if (topology == NULL) {
+		fprintf(stderr, "Memory error when finding topology.\n");
+		exit(EXIT_FAILURE);
+		}
+	if (options.nodes == 0 && Topology_getNodeCount(topology) == 1) {
+		options.nodes = SIMULATED_NODES;
+		Topology_free(topology);
+		topology = Topology_new(options.nodes);
+		if (topology == NULL) {
+			fprintf(stderr, "Memory error when finding topology.\n");
+			exit(EXIT_FAILURE);
+			}
+		}
+
+	printf("Configuration\n\tSize (Width x Height): %lu x %lu px\n\
+\tIterations: %lu\n\tExponent: %lu\n\tRepeat: %u\n",
+		params.width, params.height, params.iterations, params.exponent, repeat);
+	printf("Topology\n\tNodes: %u (%s)\n", Topology_getNodeCount(topology),
+		Topology_isSimulated(topology) ? "simulated" : "detected");
+	for (n = 0; n < Topology_getNodeCount(topology); n++) {
+		printf("\t\tNode %u: %u processors\n", Topology_getNodeId(topology, n),
+			Topology_getCpuCount(topology, n));
+		}
+	Topology_free(topology);
+
+	for (p = 0; p < PLACEMENTS; p++) {
+		options.placement = placements[p];
+		error = benchmark(&params, &options, repeat, timings + p, renderers + p);
+		if (error != RENDERER_OK) {
+			fprintf(stderr, "Error rendering with %s placement: %s\n", names[p],
+				Renderer_errorString(error));
+			Renderer_free(renderers[0]);
+			Renderer_free(renderers[1]);
+			exit(EXIT_FAILURE);
+			}
+		}
+
+	printf("Placement (%u nodes used)\n\tPlacement\tSetup (s)\tBest (s)\tMean (s)\t\
+Mpx/s\tRemote Tiles\n", Renderer_getNodeCount(renderers[0]));
+	for (p = 0; p < PLACEMENTS; p++) {
+		printf("\t%-11s\t%f\t%f\t%f\t%.2f\t%lu\n", names[p], timings[p].setup,
+			timings[p].best, timings[p].mean,
+			params.width * params.height / timings[p].best / 1e6,
+			timings[p].remote_tiles);
+		}
+	printf("\tSpeedup (local over interleaved): %.3f\n",
+		timings[1].best / timings[0].best);
+
+	identical = memcmp(Renderer_getPixels(renderers[0]), Renderer_getPixels(renderers[1]),
+		params.width * params.height * 3) == 0 &&
+		memcmp(Renderer_getIterations(renderers[0]), Renderer_getIterations(renderers[1]),
+		params.width * params.height * sizeof(uint32_t)) == 0;
+	if (! identical) fprintf(stderr, "Placements rendered different images.\n");
+
+	if (output != NULL) {
+		error = Renderer_save(renderers[0], output);
+		if (error != RENDERER_OK) {
+			fprintf(stderr, "Error saving to file %s: %s\n", output,
+				Renderer_errorString(error));
+			identical = false;
+			}
+		}
+
+	for (p = 0; p < PLACEMENTS; p++) Renderer_free(renderers[p]);
+
+	return identical ? 0 : EXIT_FAILURE;
+	}
+
+/* --- Internal Methods --- */
+/* Create a renderer with the given placement and render with it repeatedly. */
+static enum RendererError benchmark(const struct RendererParams *params,
+	struct RendererOptions *options, const unsigned repeat,
+	struct Timing *timing, Renderer_T *renderer) {
+	enum RendererError error; /* result of the current operation */
+	double start_time; /* time the current step started */
+	double elapsed; /* time of the current render */
+	double total = 0; /* time of every render */
+	unsigned r; /* current render */
+
+	start_time = Stats_now();
+	error = Renderer_new(renderer, params->width, params->height, options);
+	if (error != RENDERER_OK) return error;
+	timing->setup = Stats_now() - start_time;
+
+	for (r = 0; r < repeat; r++) {
+		start_time = Stats_now();
+		error = Renderer_render(*renderer, params);
+		if (error != RENDERER_OK) return error;
+		elapsed = Stats_now() - start_time;
+
+		total += elapsed;
+		if (r == 0 || elapsed < timing->best) timing->best = elapsed;
+		}
+
+	timing->mean = total / repeat;
+	timing->remote_tiles = Renderer_getRemoteTiles(*renderer);
+	return RENDERER_OK;
+	}
@@ -0,0 +1,234 @@
+/*
+* placement.c
+* Author: Rushy Panchal
+* Description: Placement of render buffers and tiles across memory nodes.
+*	Implements placement.h.
+*/
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <assert.h>
+#include "topology.h"
+#include "placement.h"
+
+/* A run of tiles, handed out in order. */
+struct PlacementQueue {
+	size_t next; /* next tile to hand out */
+	size_t end; /* one past the last tile */
+	};
+
+struct Placement {
+	unsigned thread_count; /* number of threads */
+	unsigned node_count; /* number of nodes used (at most one per thread) */
+	size_t pixel_count; /* number of pixels the buffers hold */
+	size_t page_size; /* size of a memory page */
+	bool interleaved; /* whether or not pages are interleaved */
+
+	struct PlacementQueue queues[TOPOLOGY_MAX_NODES]; /* tiles held by each
+		node */
+	unsigned queue_count; /* number of queues */
+	size_t remote_tiles; /* tiles taken off their node */
+	pthread_mutex_t lock; /* protects the queues and remote_tiles */
+	};
+
+/* --- Internal Method Prototypes --- */
+/*
+* Get the first thread of a node. The threads of a node are contiguous.
+* Parameters
+*	const Placement_T placement - placement of the threads
+*	const unsigned node - index of the node
+* Returns
+*	(unsigned) index of the node's first thread
+*/
+static unsigned first_thread(const Placement_T placement, const unsigned node);
+
+/* Spread threads over the nodes of a topology. */
+Placement_T Placement_new(const Topology_T topology, const unsigned threads,
+	const size_t pixel_count, const bool interleaved) {
+	Placement_T placement; /* placement for client */
+	long page_size; /* size of a memory page */
+
+	assert(topology != NULL);
+	assert(threads > 0);
+
+	placement = (Placement_T) calloc(1, sizeof(struct Placement));
+	if (placement == NULL) return NULL;
+
+	page_size = sysconf(_SC_PAGESIZE);
+	placement->page_size = (page_size > 0) ? (size_t) page_size : 4096;
+	placement->thread_count = threads;
+	placement->node_count = Topology_getNodeCount(topology);
+	if (placement->node_count > threads) placement->node_count = threads;
+	placement->pixel_count = pixel_count;
+	placement->interleaved = interleaved;
+	pthread_mutex_init(&placement->lock, NULL);
+
+	return placement;
+	}
+
+/* Free the placement. */
+void Placement_free(Placement_T placement) {
+	if (placement != NULL) pthread_mutex_destroy(&placement->lock);
+	free(placement);
+	}
+
+/* Get the number of nodes the threads are spread across. */
+unsigned Placement_getNodeCount(const Placement_T placement) {
+	assert(placement != NULL);
+
+	return placement->node_count;
+	}
+
+/* Get the node of a thread. */
+unsigned Placement_getNode(const Placement_T placement, const unsigned thread) {
+	assert(placement != NULL);
+	assert(thread < placement->thread_count);
+
+	return (unsigned) ((size_t) thread * placement->node_count /
+		placement->thread_count);
+	}
+
+/* First touch a thread's share of a buffer. */
+void Placement_touch(const Placement_T placement, const unsigned thread,
+	void *buffer, const size_t size) {
+	const size_t page_size = placement->page_size; /* size of a memory page */
+	const size_t pages = (size + page_size - 1) / page_size; /* pages in buffer */
+	const unsigned nodes = placement->node_count; /* number of nodes */
+	const unsigned node = Placement_getNode(placement, thread); /* node of the
+		thread */
+	const unsigned rank = thread - first_thread(placement, node); /* index of
+		the thread among its node's threads */
+	const unsigned peers = first_thread(placement, node + 1) -
+		first_thread(placement, node); /* threads on the thread's node */
+	uint8_t *bytes = (uint8_t*) buffer; /* buffer, as bytes */
+	size_t first; /* first page of the node's share */
+	size_t last; /* one past the last page of the node's share */
+	size_t page; /* current page */
+
+	assert(buffer != NULL || size == 0);
+
+	if (placement->interleaved) {
+		/* Page i belongs to node i % nodes; the node's threads take turns. */
+		for (page = node + (size_t) rank * nodes; page < pages;
+			page += (size_t) nodes * peers) {
+			memset(bytes + page * page_size, 0,
+				(page + 1 == pages) ? size - page * page_size : page_size);
+			}
+		return;
+		}
+
+	/* The node holds a contiguous share, which its threads split evenly.
+	Placement_queueTiles hands out tiles in the same proportions. */
+	first = pages * node / nodes;
+	last = pages * (node + 1) / nodes;
+	page = first + (last - first) * rank / peers;
+	last = first + (last - first) * (rank + 1) / peers;
+	if (page < last) {
+		memset(bytes + page * page_size, 0,
+			((last == pages) ? size : last * page_size) - page * page_size);
+		}
+	}
+
+/* Split the tiles of an image into one queue per node. */
+void Placement_queueTiles(Placement_T placement, const size_t width,
+	const size_t height, const size_t tile_size) {
+	const size_t tiles_across = (width + tile_size - 1) / tile_size; /* number
+		of tiles in each row */
+	const size_t tile_count = tiles_across *
+		((height + tile_size - 1) / tile_size); /* total number of tiles */
+	size_t tile; /* current tile */
+	size_t x; /* middle column of the tile */
+	size_t y; /* middle row of the tile */
+	unsigned node; /* node holding the tile */
+	unsigned n; /* current node */
+
+	assert(placement != NULL);
+	assert(tile_size > 0);
+	assert(width * height <= placement->pixel_count);
+
+	pthread_mutex_lock(&placement->lock);
+	placement->remote_tiles = 0;
+
+	/* Interleaved pages belong to no node in particular. */
+	if (placement->interleaved) {
+		placement->queue_count = 1;
+		placement->queues[0].next = 0;
+		placement->queues[0].end = tile_count;
+		pthread_mutex_unlock(&placement->lock);
+		return;
+		}
+
+	placement->queue_count = placement->node_count;
+	for (n = 0; n < placement->node_count; n++) {
+		placement->queues[n].next = 0;
+		placement->queues[n].end = 0;
+		}
+
+	/* Tiles are in memory order, so each node's tiles are contiguous. */
+	for (tile = 0; tile < tile_count; tile++) {
+		x = (tile % tiles_across) * tile_size + tile_size / 2;
+		y = (tile / tiles_across) * tile_size + tile_size / 2;
+		if (x >= width) x = width - 1;
+		if (y >= height) y = height - 1;
+
+		node = (unsigned) ((y * width + x) * placement->node_count /
+			placement->pixel_count);
+		if (placement->queues[node].end == 0) placement->queues[node].next = tile;
+		placement->queues[node].end = tile + 1;
+		}
+	pthread_mutex_unlock(&placement->lock);
+	}
+
+/* Take the next tile for a thread. */
+bool Placement_nextTile(Placement_T placement, const unsigned thread,
+	size_t *tile) {
+	const unsigned node = Placement_getNode(placement, thread); /* node of the
+		thread */
+	struct PlacementQueue *queue; /* queue the tile is taken from */
+	unsigned q; /* current queue (offset from the thread's own) */
+
+	assert(tile != NULL);
+
+	/* Take from the node's own queue, then from the others in turn. */
+	pthread_mutex_lock(&placement->lock);
+	for (q = 0; q < placement->queue_count; q++) {
+		queue = placement->queues + (node + q) % placement->queue_count;
+		if (queue->next < queue->end) break;
+		}
+	if (q == placement->queue_count) {
+		pthread_mutex_unlock(&placement->lock);
+		return false;
+		}
+	*tile = queue->next++;
+	if (q != 0) placement->remote_tiles++;
+	pthread_mutex_unlock(&placement->lock);
+
+	return true;
+	}
+
+/* Get the number of tiles taken off their node. */
+size_t Placement_getRemoteTiles(const Placement_T placement) {
+	size_t remote_tiles; /* tiles taken off their node */
+
+	assert(placement != NULL);
+
+	pthread_mutex_lock(&placement->lock);
+	remote_tiles = placement->remote_tiles;
+	pthread_mutex_unlock(&placement->lock);
+
+	return remote_tiles;
+	}
+
+/* --- Internal Methods --- */
+/* Get the first thread of a node. */
+static unsigned first_thread(const Placement_T placement, const unsigned node) {
+	/* Thread t is on node t * nodes / threads, so the node's first thread is
+	the smallest t with t * nodes >= node * threads. */
+	return (unsigned) (((size_t) node * placement->thread_count +
+		placement->node_count - 1) / placement->node_count);
+	}
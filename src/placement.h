@@ -0,0 +1,122 @@
+/*
+* placement.h
+* Author: Rushy Panchal
+* Description: Placement of render buffers and tiles across memory nodes.
+*	Provides the Placement_T ADT, which spreads a set of rendering threads
+*	over the nodes of a topology (see topology.h), first touches each
+*	thread's share of a buffer so that its pages are placed on the thread's
+*	node, and hands out the tiles of an image so that each node mostly
+*	renders the tiles whose pixels it holds.
+*
+*	With node-local placement, node n holds the n-th of node_count equal
+*	contiguous shares of every buffer, and each tile belongs to the node
+*	holding its middle pixel. With interleaved placement, pages are spread
+*	round-robin across the nodes and any thread renders any tile.
+*
+*	This is an internal module of the renderers; it is not part of the
+*	library interface.
+*/
+
+#ifndef PLACEMENT_INCLUDED
+#define PLACEMENT_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "topology.h"
+
+typedef struct Placement *Placement_T;
+
+/*
+* Spread threads over the nodes of a topology, in contiguous groups.
+* Parameters
+*	const Topology_T topology - topology of the machine
+*	const unsigned threads - number of threads (at least one)
+*	const size_t pixel_count - number of pixels the buffers hold
+*	const bool interleaved - whether to interleave pages instead of placing
+*		a contiguous share on each node
+* Returns
+*	(Placement_T) placement, or NULL on memory failure
+*
+* Note:
+*	At most one node is used per thread, so that every node used has a
+*	thread to touch its memory.
+*/
+Placement_T Placement_new(const Topology_T topology, const unsigned threads,
+	const size_t pixel_count, const bool interleaved);
+
+/*
+* Free the placement.
+* Parameters
+*	Placement_T placement - placement to free
+*/
+void Placement_free(Placement_T placement);
+
+/*
+* Get the number of nodes the threads are spread across.
+* Parameters
+*	const Placement_T placement - placement to get node count of
+* Returns
+*	(unsigned) number of nodes
+*/
+unsigned Placement_getNodeCount(const Placement_T placement);
+
+/*
+* Get the node of a thread.
+* Parameters
+*	const Placement_T placement - placement of the thread
+*	const unsigned thread - index of the thread
+* Returns
+*	(unsigned) index of the node (in the topology)
+*/
+unsigned Placement_getNode(const Placement_T placement, const unsigned thread);
+
+/*
+* First touch a thread's share of a buffer, so that its pages are placed on
+* the thread's node. The share is set to zero.
+* Parameters
+*	const Placement_T placement - placement of the buffer
+*	const unsigned thread - index of the thread touching the buffer
+*	void *buffer - (page-aligned) buffer to touch
+*	const size_t size - size of the buffer, in bytes
+*/
+void Placement_touch(const Placement_T placement, const unsigned thread,
+	void *buffer, const size_t size);
+
+/*
+* Split the tiles of an image into one queue per node. Tiles are numbered in
+* row-major order, and the image's pixels are the first of the buffers'.
+* Parameters
+*	Placement_T placement - placement to queue the tiles on
+*	const size_t width - width of the image
+*	const size_t height - height of the image
+*	const size_t tile_size - width and height of a (full) tile
+*/
+void Placement_queueTiles(Placement_T placement, const size_t width,
+	const size_t height, const size_t tile_size);
+
+/*
+* Take the next tile for a thread, from its node's queue first and then from
+* the others in turn. Safe to call from several threads at once.
+* Parameters
+*	Placement_T placement - placement to take the tile from
+*	const unsigned thread - index of the thread taking the tile
+*	size_t *tile - where to store the tile
+* Returns
+*	(bool) true if a tile was taken, false if every queue is empty
+*/
+bool Placement_nextTile(Placement_T placement, const unsigned thread,
+	size_t *tile);
+
+/*
+* Get the number of tiles taken by a thread on another node than the one
+* holding their pixels, since the tiles were last queued. This is always 0
+* with interleaved placement.
+* Parameters
+*	const Placement_T placement - placement to get tile count of
+* Returns
+*	(size_t) number of tiles rendered off their node
+*/
+size_t Placement_getRemoteTiles(const Placement_T placement);
+
+#endif
@@ -0,0 +1,174 @@
+/*
+* raw.c
+* Author: Rushy Panchal
+* Description: Reads and writes raw pixel buffers. Implements raw.h.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <assert.h>
+#include "raw.h"
+
+#define MAGIC "MBRAW01"
+#define MAGIC_SIZE 8
+#define EXTENSION ".raw"
+
+/* The header of a raw buffer file. Its size keeps the pixels 8-byte aligned. */
+struct RawHeader {
+	char magic[MAGIC_SIZE]; /* MAGIC, including the terminator */
+	uint64_t width; /* width, in pixels */
+	uint64_t height; /* height, in pixels */
+	uint32_t channels; /* channels per pixel */
+	uint32_t channel_size; /* bytes per channel */
+	};
+
+struct Raw {
+	void *map; /* mapping of the whole file */
+	size_t map_size; /* size of the mapping */
+	const struct RawHeader *header; /* header of the file */
+	const uint8_t *data; /* pixels of the file */
+	};
+
+/* Map a raw buffer file into memory. */
+Raw_T Raw_open(const char *path) {
+	Raw_T raw; /* raw buffer for client */
+	int fd; /* file descriptor of the file */
+	struct stat info; /* information about the file */
+	const struct RawHeader *header; /* header of the file */
+
+	assert(path != NULL);
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) return NULL;
+
+	if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(struct RawHeader)) {
+		close(fd);
+		return NULL;
+		}
+
+	raw = (Raw_T) malloc(sizeof(struct Raw));
+	if (raw == NULL) {
+		close(fd);
+		return NULL;
+		}
+
+	/* The mapping outlives the file descriptor. */
+	raw->map_size = (size_t) info.st_size;
+	raw->map = mmap(NULL, raw->map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (raw->map == MAP_FAILED) {
+		free(raw);
+		return NULL;
+		}
+
+	/* Validate the header against the size of the file. The fields are
+	untrusted, so each product is checked for overflow before it is taken. */
+	header = (const struct RawHeader*) raw->map;
+	if (memcmp(header->magic, MAGIC, MAGIC_SIZE) != 0 ||
+		header->channels == 0 ||
+		(header->channel_size != 1 && header->channel_size != 2 &&
+		header->channel_size != 4) ||
+		(header->height != 0 && header->width > SIZE_MAX / header->height) ||
+		header->width * header->height > SIZE_MAX / header->channels /
+		header->channel_size ||
+		header->width * header->height * header->channels * header->channel_size !=
+		raw->map_size - sizeof(struct RawHeader)) {
+		munmap(raw->map, raw->map_size);
+		free(raw);
+		return NULL;
+		}
+
+	raw->header = header;
+	raw->data = (const uint8_t*) raw->map + sizeof(struct RawHeader);
+	return raw;
+	}
+
+/* Unmap the raw buffer. */
+void Raw_close(Raw_T raw) {
+	if (raw != NULL) munmap(raw->map, raw->map_size);
+	free(raw);
+	}
+
+/* Get the width of a raw buffer. */
+size_t Raw_getWidth(const Raw_T raw) {
+	assert(raw != NULL);
+
+	return (size_t) raw->header->width;
+	}
+
+/* Get the height of a raw buffer. */
+size_t Raw_getHeight(const Raw_T raw) {
+	assert(raw != NULL);
+
+	return (size_t) raw->header->height;
+	}
+
+/* Get the number of channels per pixel of a raw buffer. */
+size_t Raw_getChannels(const Raw_T raw) {
+	assert(raw != NULL);
+
+	return raw->header->channels;
+	}
+
+/* Get the number of bytes per channel of a raw buffer. */
+size_t Raw_getChannelSize(const Raw_T raw) {
+	assert(raw != NULL);
+
+	return raw->header->channel_size;
+	}
+
+/* Get the pixels of a raw buffer. */
+const uint8_t *Raw_getData(const Raw_T raw) {
+	assert(raw != NULL);
+
+	return raw->data;
+	}
+
+/* Check whether a path names a raw buffer file. */
+bool Raw_isRawPath(const char *path) {
+	size_t length; /* length of the path */
+
+	assert(path != NULL);
+
+	length = strlen(path);
+	return length >= strlen(EXTENSION) &&
+		strcmp(path + length - strlen(EXTENSION), EXTENSION) == 0;
+	}
+
+/* Save pixels to a raw buffer file. */
+bool Raw_save(const char *path, const void *data, const size_t width,
+	const size_t height, const size_t channels, const size_t channel_size) {
+	FILE *fp; /* file pointer to save the buffer */
+	struct RawHeader header; /* header of the file */
+	size_t size; /* size of the pixels, in bytes */
+
+	assert(path != NULL);
+	assert(data != NULL || width * height == 0);
+
+	memset(&header, 0, sizeof(struct RawHeader));
+	memcpy(header.magic, MAGIC, MAGIC_SIZE);
+	header.width = width;
+	header.height = height;
+	header.channels = (uint32_t) channels;
+	header.channel_size = (uint32_t) channel_size;
+	size = width * height * channels * channel_size;
+
+	fp = fopen(path, "wb");
+	if (fp == NULL) return false;
+
+	if (fwrite(&header, sizeof(struct RawHeader), 1, fp) != 1 ||
+		(size != 0 && fwrite(data, size, 1, fp) != 1)) {
+		fclose(fp);
+		return false;
+		}
+
+	return fclose(fp) == 0;
+	}
@@ -0,0 +1,112 @@
+/*
+* raw.h
+* Author: Rushy Panchal
+* Description: Reads and writes raw (uncompressed) pixel buffers. Provides the
+*	Raw_T ADT, which maps a raw buffer file into memory so it can be used
+*	without decoding. A raw buffer can hold RGB pixels as well as wider
+*	channels, such as 32-bit iteration counts.
+*
+*	File format (native endian):
+*		8 bytes - magic "MBRAW01\0"
+*		8 bytes - width, in pixels
+*		8 bytes - height, in pixels
+*		4 bytes - channels per pixel
+*		4 bytes - bytes per channel (1, 2 or 4)
+*		width * height * channels * bytes per channel - pixels, row-major
+*/
+
+#ifndef RAW_INCLUDED
+#define RAW_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct Raw *Raw_T;
+
+/*
+* Map a raw buffer file into memory (read-only).
+* Parameters
+*	const char *path - path of the file
+* Returns
+*	(Raw_T) raw buffer (or NULL if the file is not a valid raw buffer)
+*/
+Raw_T Raw_open(const char *path);
+
+/*
+* Unmap the raw buffer.
+* Parameters
+*	Raw_T raw - raw buffer to unmap
+*/
+void Raw_close(Raw_T raw);
+
+/*
+* Get the width of a raw buffer.
+* Parameters
+*	const Raw_T raw - raw buffer to get width of
+* Returns
+*	(size_t) width of the buffer
+*/
+size_t Raw_getWidth(const Raw_T raw);
+
+/*
+* Get the height of a raw buffer.
+* Parameters
+*	const Raw_T raw - raw buffer to get height of
+* Returns
+*	(size_t) height of the buffer
+*/
+size_t Raw_getHeight(const Raw_T raw);
+
+/*
+* Get the number of channels per pixel of a raw buffer.
+* Parameters
+*	const Raw_T raw - raw buffer to get channels of
+* Returns
+*	(size_t) channels per pixel
+*/
+size_t Raw_getChannels(const Raw_T raw);
+
+/*
+* Get the number of bytes per channel of a raw buffer.
+* Parameters
+*	const Raw_T raw - raw buffer to get channel size of
+* Returns
+*	(size_t) bytes per channel
+*/
+size_t Raw_getChannelSize(const Raw_T raw);
+
+/*
+* Get the pixels of a raw buffer.
+* Parameters
+*	const Raw_T raw - raw buffer to get pixels of
+* Returns
+*	(const uint8_t*) pixels, in row-major order
+*/
+const uint8_t *Raw_getData(const Raw_T raw);
+
+/*
+* Check whether a path names a raw buffer file, by its .raw extension.
+* Parameters
+*	const char *path - path to check
+* Returns
+*	(bool) true if the path ends in .raw, false otherwise
+*/
+bool Raw_isRawPath(const char *path);
+
+/*
+* Save pixels to a raw buffer file.
+* Parameters
+*	const char *path - path of the file to save to
+*	const void *data - pixels, in row-major order
+*	const size_t width - width of the buffer
+*	const size_t height - height of the buffer
+*	const size_t channels - channels per pixel
+*	const size_t channel_size - bytes per channel
+* Returns
+*	(bool) true on success, false on failure
+*/
+bool Raw_save(const char *path, const void *data, const size_t width,
+	const size_t height, const size_t channels, const size_t channel_size);
+
+#endif
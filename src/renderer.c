@@ -0,0 +1,452 @@
+/*
+* renderer.c
+* Author: Rushy Panchal
+* Description: A reusable render context for the Mandelbrot Set. Implements
+*	renderer.h.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <assert.h>
+#include "image.h"
+#include "raw.h"
+#include "mandelbrot.h"
+#include "topology.h"
+#include "placement.h"
+#include "renderer.h"
+
+#define TILE_SIZE 64
+#define MAX_THREADS 256
+#define PIXEL_SIZE 3
+
+/* Work the pool can be woken up for. */
+enum RendererTask {
+	TASK_TOUCH, /* first touch each node's share of the buffers */
+	TASK_RENDER /* render the current image */
+	};
+
+/* A thread of the pool. */
+struct RendererThread {
+	Renderer_T renderer; /* renderer the thread belongs to */
+	pthread_t thread; /* the thread */
+	unsigned index; /* index of the thread (see placement.h) */
+	};
+
+struct Renderer {
+	/* Buffers, sized for the largest image. */
+	size_t max_width; /* largest width that can be rendered */
+	size_t max_height; /* largest height that can be rendered */
+	uint8_t *pixels; /* RGB pixels of the last render */
+	uint32_t *iterations; /* iteration counts of the last render */
+	double *xs; /* x coordinate of each column */
+	double *ys; /* y coordinate of each row */
+
+	/* Placement of the buffers and tiles. */
+	Topology_T topology; /* topology of the machine */
+	Placement_T placement; /* placement of the buffers and tiles */
+
+	/* The current (or last) render. */
+	size_t width; /* width of the image */
+	size_t height; /* height of the image */
+	unsigned long iteration_limit; /* iterations per pixel */
+	unsigned long exponent; /* exponent for the set */
+	double radius; /* escape radius of the set */
+	MandelbrotKernel kernel; /* kernel for the exponent */
+	size_t tiles_across; /* number of tiles in each row */
+
+	/* The thread pool. The caller of Renderer_render waits while it works. */
+	struct RendererThread threads[MAX_THREADS]; /* pool threads */
+	unsigned thread_count; /* number of pool threads */
+	pthread_mutex_t lock; /* protects everything below */
+	pthread_cond_t start; /* signalled when a task starts */
+	pthread_cond_t finish; /* signalled when the pool finishes a task */
+	enum RendererTask task; /* current task */
+	unsigned long generation; /* number of tasks started */
+	unsigned busy; /* pool threads still working on the current task */
+	bool shutdown; /* whether or not the pool should exit */
+	};
+
+/* --- Internal Method Prototypes --- */
+/*
+* Pin the thread to its node, then wait for tasks and carry them out, until
+* shutdown.
+* Parameters
+*	void *arg - (struct RendererThread*) the thread
+* Returns
+*	(void*) NULL
+*/
+static void *Renderer_thread(void *arg);
+
+/*
+* Wake the pool for a task and wait for it to finish.
+* Parameters
+*	Renderer_T renderer - renderer to run the task on
+*	const enum RendererTask task - task to run
+*/
+static void Renderer_run(Renderer_T renderer, const enum RendererTask task);
+
+/*
+* Render tiles of the current render until there are none left, starting
+* with those held by the thread's node (see Placement_nextTile).
+* Parameters
+*	struct RendererThread *thread - thread to render on
+*/
+static void Renderer_work(struct RendererThread *thread);
+
+/*
+* Stop and join the pool threads, and free the renderer.
+* Parameters
+*	Renderer_T renderer - renderer to destroy
+*/
+static void Renderer_destroy(Renderer_T renderer);
+
+/* Set the default options. */
+void Renderer_defaultOptions(struct RendererOptions *options) {
+	assert(options != NULL);
+
+	options->threads = 0;
+	options->nodes = 0;
+	options->placement = RENDERER_PLACEMENT_LOCAL;
+	}
+
+/* Create a renderer for images of up to the given size. */
+enum RendererError Renderer_new(Renderer_T *renderer, const size_t max_width,
+	const size_t max_height, const struct RendererOptions *options) {
+	struct RendererOptions defaults; /* options used without any given */
+	Renderer_T result; /* renderer for client */
+	unsigned count; /* number of threads */
+	unsigned t; /* current thread */
+	long cpus; /* number of online processors */
+	long page_size; /* size of a memory page */
+	size_t pixel_count; /* number of pixels in the largest image */
+
+	assert(renderer != NULL);
+
+	if (options == NULL) {
+		Renderer_defaultOptions(&defaults);
+		options = &defaults;
+		}
+
+	*renderer = NULL;
+	if (max_width == 0 || max_height == 0 ||
+		max_width > SIZE_MAX / PIXEL_SIZE / sizeof(uint32_t) / max_height ||
+		(options->placement != RENDERER_PLACEMENT_LOCAL &&
+		options->placement != RENDERER_PLACEMENT_INTERLEAVED))
+		return RENDERER_ERROR_ARGUMENT;
+	pixel_count = max_width * max_height;
+
+	result = (Renderer_T) calloc(1, sizeof(struct Renderer));
+	if (result == NULL) return RENDERER_ERROR_MEMORY;
+
+	result->max_width = max_width;
+	result->max_height = max_height;
+	result->topology = Topology_new(options->nodes);
+	if (result->topology == NULL) {
+		free(result);
+		return RENDERER_ERROR_MEMORY;
+		}
+
+	/* Every node used needs a thread to touch its memory, so by default
+	there is at least one thread per node. */
+	cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	count = (options->threads != 0) ? options->threads : (cpus < 1) ? 1 : (unsigned) cpus;
+	if (options->threads == 0 && count < Topology_getNodeCount(result->topology))
+		count = Topology_getNodeCount(result->topology);
+	if (count > MAX_THREADS) count = MAX_THREADS;
+
+	/* The buffers are page-aligned so that each node's share starts on a
+	page of its own, and left untouched until the pool touches them. */
+	page_size = sysconf(_SC_PAGESIZE);
+	if (page_size <= 0) page_size = 4096;
+	result->placement = Placement_new(result->topology, count, pixel_count,
+		options->placement == RENDERER_PLACEMENT_INTERLEAVED);
+	if (result->placement == NULL ||
+		posix_memalign((void**) &result->pixels, (size_t) page_size,
+		pixel_count * PIXEL_SIZE) != 0 ||
+		posix_memalign((void**) &result->iterations, (size_t) page_size,
+		pixel_count * sizeof(uint32_t)) != 0 ||
+		(result->xs = (double*) malloc(sizeof(double) * (max_width + max_height))) == NULL) {
+		Placement_free(result->placement);
+		Topology_free(result->topology);
+		free(result->pixels);
+		free(result->iterations);
+		free(result);
+		return RENDERER_ERROR_MEMORY;
+		}
+	result->ys = result->xs + max_width;
+
+#ifdef MADV_NOHUGEPAGE
+	/* A transparent huge page would be placed whole on the node of the
+	first thread to touch any part of it, blurring the shares (and the
+	interleaving), which are laid out in base pages. If this fails, only
+	the placement suffers. */
+	madvise(result->pixels, pixel_count * PIXEL_SIZE, MADV_NOHUGEPAGE);
+	madvise(result->iterations, pixel_count * sizeof(uint32_t), MADV_NOHUGEPAGE);
+#endif
+
+	pthread_mutex_init(&result->lock, NULL);
+	pthread_cond_init(&result->start, NULL);
+	pthread_cond_init(&result->finish, NULL);
+
+	/* Threads are spread over the nodes in contiguous groups. */
+	for (t = 0; t < count; t++) {
+		result->threads[t].renderer = result;
+		result->threads[t].index = t;
+		if (pthread_create(&result->threads[t].thread, NULL, Renderer_thread,
+			result->threads + t) != 0) {
+			result->thread_count = t;
+			Renderer_destroy(result);
+			return RENDERER_ERROR_THREAD;
+			}
+		}
+	result->thread_count = t;
+
+	Renderer_run(result, TASK_TOUCH);
+
+	*renderer = result;
+	return RENDERER_OK;
+	}
+
+/* Free the renderer. */
+void Renderer_free(Renderer_T renderer) {
+	if (renderer != NULL) Renderer_destroy(renderer);
+	}
+
+/* Render the Mandelbrot Set into the renderer's buffers. */
+enum RendererError Renderer_render(Renderer_T renderer,
+	const struct RendererParams *params) {
+	assert(renderer != NULL);
+	assert(params != NULL);
+
+	if (params->width == 0 || params->height == 0 ||
+		params->iterations > UINT32_MAX) return RENDERER_ERROR_ARGUMENT;
+	if (params->width > renderer->max_width || params->height > renderer->max_height)
+		return RENDERER_ERROR_SIZE;
+
+	renderer->width = params->width;
+	renderer->height = params->height;
+	renderer->iteration_limit = params->iterations;
+	renderer->exponent = params->exponent;
+	renderer->radius = params->radius;
+	renderer->kernel = generate_mandelbrot_kernel(params->exponent);
+	renderer->tiles_across = (params->width + TILE_SIZE - 1) / TILE_SIZE;
+	Placement_queueTiles(renderer->placement, params->width, params->height,
+		TILE_SIZE);
+
+	generate_mandelbrot_coordinates(params->width, params->height,
+		params->xmin, params->xmax, params->ymin, params->ymax,
+		renderer->xs, renderer->ys);
+
+	Renderer_run(renderer, TASK_RENDER);
+
+	return RENDERER_OK;
+	}
+
+/* Get the width of the last render. */
+size_t Renderer_getWidth(const Renderer_T renderer) {
+	assert(renderer != NULL);
+
+	return renderer->width;
+	}
+
+/* Get the height of the last render. */
+size_t Renderer_getHeight(const Renderer_T renderer) {
+	assert(renderer != NULL);
+
+	return renderer->height;
+	}
+
+/* Get the number of nodes the renderer's threads are spread across. */
+unsigned Renderer_getNodeCount(const Renderer_T renderer) {
+	assert(renderer != NULL);
+
+	return Placement_getNodeCount(renderer->placement);
+	}
+
+/* Get the number of tiles of the last render rendered off their node. */
+size_t Renderer_getRemoteTiles(const Renderer_T renderer) {
+	assert(renderer != NULL);
+
+	return Placement_getRemoteTiles(renderer->placement);
+	}
+
+/* Get the pixels of the last render. */
+const uint8_t *Renderer_getPixels(const Renderer_T renderer) {
+	assert(renderer != NULL);
+
+	return renderer->pixels;
+	}
+
+/* Get the iterations run by each pixel of the last render. */
+const uint32_t *Renderer_getIterations(const Renderer_T renderer) {
+	assert(renderer != NULL);
+
+	return renderer->iterations;
+	}
+
+/* Save the last render to a file. */
+enum RendererError Renderer_save(const Renderer_T renderer, const char *path) {
+	bool saved; /* whether or not the file was saved */
+
+	assert(renderer != NULL);
+	assert(path != NULL);
+
+	if (renderer->width == 0) return RENDERER_ERROR_ARGUMENT;
+
+	if (Raw_isRawPath(path))
+		saved = Raw_save(path, renderer->pixels, renderer->width, renderer->height,
+			PIXEL_SIZE, sizeof(uint8_t));
+	else saved = Image_savePixels(renderer->pixels, renderer->width,
+		renderer->height, path);
+
+	return saved ? RENDERER_OK : RENDERER_ERROR_IO;
+	}
+
+/* Save the iteration counts of the last render to a raw buffer file. */
+enum RendererError Renderer_saveIterations(const Renderer_T renderer,
+	const char *path) {
+	assert(renderer != NULL);
+	assert(path != NULL);
+
+	if (renderer->width == 0) return RENDERER_ERROR_ARGUMENT;
+
+	return Raw_save(path, renderer->iterations, renderer->width, renderer->height,
+		1, sizeof(uint32_t)) ? RENDERER_OK : RENDERER_ERROR_IO;
+	}
+
+/* Describe an error code. */
+const char *Renderer_errorString(const enum RendererError error) {
+	switch (error) {
+		case RENDERER_OK:
+			return "success";
+		case RENDERER_ERROR_MEMORY:
+			return "memory exhausted";
+		case RENDERER_ERROR_THREAD:
+			return "rendering thread could not be started";
+		case RENDERER_ERROR_SIZE:
+			return "image is larger than the renderer";
+		case RENDERER_ERROR_ARGUMENT:
+			return "argument out of range";
+		case RENDERER_ERROR_IO:
+			return "file could not be written";
+		}
+
+	return "unknown error";
+	}
+
+/* --- Internal Methods --- */
+/* Pin the thread to its node, then carry out tasks until shutdown. */
+static void *Renderer_thread(void *arg) {
+	struct RendererThread *thread = (struct RendererThread*) arg; /* the thread */
+	Renderer_T renderer = thread->renderer; /* renderer of the thread */
+	unsigned long seen = 0; /* last task carried out */
+	size_t pixel_count; /* number of pixels in the largest image */
+
+	/* If pinning fails, the thread still runs (just unpinned). */
+	Topology_bind(renderer->topology,
+		Placement_getNode(renderer->placement, thread->index));
+	pixel_count = renderer->max_width * renderer->max_height;
+
+	pthread_mutex_lock(&renderer->lock);
+	for (;;) {
+		while (renderer->generation == seen && ! renderer->shutdown)
+			pthread_cond_wait(&renderer->start, &renderer->lock);
+		if (renderer->shutdown) break;
+		seen = renderer->generation;
+		pthread_mutex_unlock(&renderer->lock);
+
+		if (renderer->task == TASK_TOUCH) {
+			Placement_touch(renderer->placement, thread->index, renderer->pixels,
+				pixel_count * PIXEL_SIZE);
+			Placement_touch(renderer->placement, thread->index,
+				renderer->iterations, pixel_count * sizeof(uint32_t));
+			}
+		else Renderer_work(thread);
+
+		pthread_mutex_lock(&renderer->lock);
+		if (--renderer->busy == 0) pthread_cond_signal(&renderer->finish);
+		}
+	pthread_mutex_unlock(&renderer->lock);
+
+	return NULL;
+	}
+
+/* Wake the pool for a task and wait for it to finish. */
+static void Renderer_run(Renderer_T renderer, const enum RendererTask task) {
+	pthread_mutex_lock(&renderer->lock);
+	renderer->task = task;
+	renderer->busy = renderer->thread_count;
+	renderer->generation++;
+	pthread_cond_broadcast(&renderer->start);
+	while (renderer->busy > 0) pthread_cond_wait(&renderer->finish, &renderer->lock);
+	pthread_mutex_unlock(&renderer->lock);
+	}
+
+/* Render tiles of the current render until there are none left. */
+static void Renderer_work(struct RendererThread *thread) {
+	Renderer_T renderer = thread->renderer; /* renderer of the thread */
+	uint8_t draw[TILE_SIZE * TILE_SIZE]; /* draw flags of the current tile */
+	uint32_t counts[TILE_SIZE * TILE_SIZE]; /* iterations of the current tile */
+	size_t tile; /* current tile */
+	size_t x0; /* leftmost column of the tile */
+	size_t y0; /* topmost row of the tile */
+	size_t tile_width; /* width of the tile */
+	size_t tile_height; /* height of the tile */
+	size_t w; /* iterating width (within the tile) */
+	size_t h; /* iterating height (within the tile) */
+	uint8_t *pixel; /* current pixel */
+	const uint8_t *flag; /* current draw flag */
+
+	while (Placement_nextTile(renderer->placement, thread->index, &tile)) {
+		x0 = (tile % renderer->tiles_across) * TILE_SIZE;
+		y0 = (tile / renderer->tiles_across) * TILE_SIZE;
+		tile_width = (x0 + TILE_SIZE > renderer->width) ? renderer->width - x0 : TILE_SIZE;
+		tile_height = (y0 + TILE_SIZE > renderer->height) ? renderer->height - y0 : TILE_SIZE;
+
+		renderer->kernel(renderer->xs, renderer->ys, renderer->iteration_limit,
+			renderer->exponent, renderer->radius, x0, y0, tile_width,
+			tile_height, draw, counts);
+
+		/* Every pixel is written, so the buffers never need clearing. */
+		for (h = 0, flag = draw; h < tile_height; h++) {
+			pixel = renderer->pixels + ((y0 + h) * renderer->width + x0) * PIXEL_SIZE;
+			for (w = 0; w < tile_width; w++, flag++, pixel += PIXEL_SIZE) {
+				pixel[0] = 0;
+				pixel[1] = 0;
+				pixel[2] = *flag ? 255 : 0;
+				}
+			memcpy(renderer->iterations + (y0 + h) * renderer->width + x0,
+				counts + h * tile_width, tile_width * sizeof(uint32_t));
+			}
+		}
+	}
+
+/* Stop and join the pool threads, and free the renderer. */
+static void Renderer_destroy(Renderer_T renderer) {
+	unsigned t; /* current pool thread */
+
+	pthread_mutex_lock(&renderer->lock);
+	renderer->shutdown = true;
+	pthread_cond_broadcast(&renderer->start);
+	pthread_mutex_unlock(&renderer->lock);
+
+	for (t = 0; t < renderer->thread_count; t++)
+		pthread_join(renderer->threads[t].thread, NULL);
+
+	pthread_cond_destroy(&renderer->start);
+	pthread_cond_destroy(&renderer->finish);
+	pthread_mutex_destroy(&renderer->lock);
+	Placement_free(renderer->placement);
+	Topology_free(renderer->topology);
+	free(renderer->pixels);
+	free(renderer->iterations);
+	free(renderer->xs);
+	free(renderer);
+	}
@@ -0,0 +1,199 @@
+/*
+* renderer.h
+* Author: Rushy Panchal
+* Description: A reusable render context for the Mandelbrot Set. Provides the
+*	Renderer_T ADT, which owns a pool of rendering threads, pixel and iteration
+*	buffers sized for the largest image it will render, and the coordinate
+*	tables and kernel of the current render. Once created, a renderer can
+*	render any number of images without allocating, and it reports failures
+*	as error codes rather than exiting.
+*
+*	The renderer is NUMA-aware: its threads are pinned to the memory nodes of
+*	the machine (see topology.h), each node's share of the buffers is first
+*	touched by that node's threads, and tiles are handed out so that each
+*	node mostly writes its own memory. The buffers are shared out for the
+*	largest image, so smaller images lean toward the first nodes.
+*
+*	A renderer may only be used by one thread at a time.
+*/
+
+#ifndef RENDERER_INCLUDED
+#define RENDERER_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "topology.h"
+
+typedef struct Renderer *Renderer_T;
+
+/* Result of a renderer operation. */
+enum RendererError {
+	RENDERER_OK = 0, /* success */
+	RENDERER_ERROR_MEMORY, /* memory exhaustion */
+	RENDERER_ERROR_THREAD, /* a rendering thread could not be started */
+	RENDERER_ERROR_SIZE, /* the image does not fit in the renderer's buffers */
+	RENDERER_ERROR_ARGUMENT, /* an argument is out of range */
+	RENDERER_ERROR_IO /* a file could not be written */
+	};
+
+/* Placement of the buffers across memory nodes. */
+enum RendererPlacement {
+	RENDERER_PLACEMENT_LOCAL = 0, /* each node holds a contiguous share of the
+		buffers, and its threads render the tiles in that share first */
+	RENDERER_PLACEMENT_INTERLEAVED /* pages are spread round-robin across the
+		nodes, and any thread renders any tile */
+	};
+
+/* Options of a renderer. */
+struct RendererOptions {
+	unsigned threads; /* number of rendering threads, or 0 for one per processor
+		(and at least one per node) */
+	unsigned nodes; /* number of nodes to simulate, or 0 to detect them */
+	enum RendererPlacement placement; /* placement of the buffers */
+	};
+
+/* Parameters of a single render. */
+struct RendererParams {
+	size_t width; /* width of the image */
+	size_t height; /* height of the image */
+	unsigned long iterations; /* iterations per pixel (at most UINT32_MAX) */
+	unsigned long exponent; /* exponent for the set */
+	double xmin; /* minimum x value of the graph */
+	double xmax; /* maximum x value of the graph */
+	double ymin; /* minimum y value of the graph */
+	double ymax; /* maximum y value of the graph */
+	double radius; /* escape radius of the set */
+	};
+
+/*
+* Set the default options: one thread per processor, detected nodes and
+* node-local placement.
+* Parameters
+*	struct RendererOptions *options - options to set
+*/
+void Renderer_defaultOptions(struct RendererOptions *options);
+
+/*
+* Create a renderer for images of up to the given size.
+* Parameters
+*	Renderer_T *renderer - where to store the renderer
+*	const size_t max_width - largest width that will be rendered
+*	const size_t max_height - largest height that will be rendered
+*	const struct RendererOptions *options - options of the renderer, or NULL
+*		for the defaults
+* Returns
+*	(enum RendererError) RENDERER_OK on success, an error code otherwise
+*/
+enum RendererError Renderer_new(Renderer_T *renderer, const size_t max_width,
+	const size_t max_height, const struct RendererOptions *options);
+
+/*
+* Free the renderer, stopping its threads.
+* Parameters
+*	Renderer_T renderer - renderer to free
+*/
+void Renderer_free(Renderer_T renderer);
+
+/*
+* Render the Mandelbrot Set into the renderer's buffers. The calling thread
+* waits while the pool renders the image.
+* Parameters
+*	Renderer_T renderer - renderer to render with
+*	const struct RendererParams *params - parameters of the render
+* Returns
+*	(enum RendererError) RENDERER_OK on success, an error code otherwise
+*/
+enum RendererError Renderer_render(Renderer_T renderer,
+	const struct RendererParams *params);
+
+/*
+* Get the width of the last render.
+* Parameters
+*	const Renderer_T renderer - renderer to get width of
+* Returns
+*	(size_t) width of the last render (0 if there was none)
+*/
+size_t Renderer_getWidth(const Renderer_T renderer);
+
+/*
+* Get the height of the last render.
+* Parameters
+*	const Renderer_T renderer - renderer to get height of
+* Returns
+*	(size_t) height of the last render (0 if there was none)
+*/
+size_t Renderer_getHeight(const Renderer_T renderer);
+
+/*
+* Get the number of nodes the renderer's threads are spread across.
+* Parameters
+*	const Renderer_T renderer - renderer to get node count of
+* Returns
+*	(unsigned) number of nodes
+*/
+unsigned Renderer_getNodeCount(const Renderer_T renderer);
+
+/*
+* Get the number of tiles of the last render that were rendered by a thread
+* on another node than the one holding their pixels. This is always 0 with
+* interleaved placement.
+* Parameters
+*	const Renderer_T renderer - renderer to get tile count of
+* Returns
+*	(size_t) number of tiles rendered off their node
+*/
+size_t Renderer_getRemoteTiles(const Renderer_T renderer);
+
+/*
+* Get the pixels of the last render. They are overwritten by the next render.
+* Parameters
+*	const Renderer_T renderer - renderer to get pixels of
+* Returns
+*	(const uint8_t*) 8-bit RGB triples, in row-major order
+*/
+const uint8_t *Renderer_getPixels(const Renderer_T renderer);
+
+/*
+* Get the iterations run by each pixel of the last render. They are
+* overwritten by the next render.
+* Parameters
+*	const Renderer_T renderer - renderer to get iterations of
+* Returns
+*	(const uint32_t*) iteration counts, in row-major order
+*/
+const uint32_t *Renderer_getIterations(const Renderer_T renderer);
+
+/*
+* Save the last render to a file, as a raw buffer (see raw.h) if the path
+* ends in .raw and as a PNG image otherwise.
+* Parameters
+*	const Renderer_T renderer - renderer to save
+*	const char *path - path of the file to save to
+* Returns
+*	(enum RendererError) RENDERER_OK on success, an error code otherwise
+*/
+enum RendererError Renderer_save(const Renderer_T renderer, const char *path);
+
+/*
+* Save the iteration counts of the last render to a raw buffer file (see raw.h).
+* Parameters
+*	const Renderer_T renderer - renderer to save
+*	const char *path - path of the file to save to
+* Returns
+*	(enum RendererError) RENDERER_OK on success, an error code otherwise
+*/
+enum RendererError Renderer_saveIterations(const Renderer_T renderer,
+	const char *path);
+
+/*
+* Describe an error code.
+* Parameters
+*	const enum RendererError error - error code to describe
+* Returns
+*	(const char*) description of the error
+*/
+const char *Renderer_errorString(const enum RendererError error);
+
+#endif
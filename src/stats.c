@@ -0,0 +1,304 @@
+/*
+* stats.c
+* Author: Rushy Panchal
+* Description: Hot-path instrumentation for the renderer. Implements stats.h.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include <assert.h>
+#include "image.h"
+#include "stats.h"
+
+#define HEATMAP_CELL 8
+
+struct Stats {
+	size_t width; /* width of the rendered image */
+	size_t height; /* height of the rendered image */
+	size_t tile_size; /* width and height of a (full) tile */
+	size_t tiles_across; /* number of tiles in each row */
+	size_t tiles_down; /* number of tiles in each column */
+	unsigned thread_count; /* number of rendering threads */
+	struct TileStats *tiles; /* tiles, in row-major order */
+	struct ThreadStats *threads; /* rendering threads */
+	double render_time; /* wall time of the render */
+	double save_time; /* wall time of saving the image */
+	};
+
+static Stats_T active = NULL; /* collector that the renderer records into */
+
+/* --- Internal Method Prototypes --- */
+/*
+* Map a value in [0, 1] to a black-red-yellow-white heatmap color.
+* Parameters
+*	const double t - value to map
+*	uint8_t *red - red value of the color
+*	uint8_t *green - green value of the color
+*	uint8_t *blue - blue value of the color
+*/
+static void Stats_heatColor(const double t, uint8_t *red, uint8_t *green,
+	uint8_t *blue);
+
+/* Create a new, empty statistics collector. */
+Stats_T Stats_new(void) {
+	return (Stats_T) calloc(1, sizeof(struct Stats));
+	}
+
+/* Free the statistics collector. */
+void Stats_free(Stats_T stats) {
+	if (stats != NULL) {
+		if (active == stats) active = NULL;
+		free(stats->tiles);
+		free(stats->threads);
+		}
+	free(stats);
+	}
+
+/* Set the collector that the renderer records into. */
+void Stats_setActive(Stats_T stats) {
+	active = stats;
+	}
+
+/* Get the collector that the renderer records into. */
+Stats_T Stats_getActive(void) {
+	return active;
+	}
+
+/* Prepare the collector for a render. */
+bool Stats_beginRender(Stats_T stats, const size_t width, const size_t height,
+	const size_t tile_size, const unsigned threads) {
+	size_t tiles_across; /* number of tiles in each row */
+	size_t tiles_down; /* number of tiles in each column */
+	struct TileStats *tile_stats; /* statistics of every tile */
+	struct ThreadStats *thread_stats; /* statistics of every thread */
+	size_t index; /* current tile index */
+
+	assert(stats != NULL);
+	assert(tile_size > 0);
+	assert(threads > 0);
+
+	tiles_across = (width + tile_size - 1) / tile_size;
+	tiles_down = (height + tile_size - 1) / tile_size;
+
+	/* One extra tile so that an empty image is not mistaken for an
+	allocation failure. */
+	tile_stats = (struct TileStats*) calloc(tiles_across * tiles_down + 1,
+		sizeof(struct TileStats));
+	if (tile_stats == NULL) return false;
+
+	thread_stats = (struct ThreadStats*) calloc(threads,
+		sizeof(struct ThreadStats));
+	if (thread_stats == NULL) {
+		free(tile_stats);
+		return false;
+		}
+
+	/* The tile geometry is known up front, so fill it in here rather than
+	in the hot path. */
+	for (index = 0; index < tiles_across * tiles_down; index++) {
+		tile_stats[index].x = (index % tiles_across) * tile_size;
+		tile_stats[index].y = (index / tiles_across) * tile_size;
+		tile_stats[index].width = (tile_stats[index].x + tile_size > width) ?
+			width - tile_stats[index].x : tile_size;
+		tile_stats[index].height = (tile_stats[index].y + tile_size > height) ?
+			height - tile_stats[index].y : tile_size;
+		}
+
+	free(stats->tiles);
+	free(stats->threads);
+
+	stats->width = width;
+	stats->height = height;
+	stats->tile_size = tile_size;
+	stats->tiles_across = tiles_across;
+	stats->tiles_down = tiles_down;
+	stats->thread_count = threads;
+	stats->tiles = tile_stats;
+	stats->threads = thread_stats;
+	stats->render_time = 0;
+	stats->save_time = 0;
+
+	return true;
+	}
+
+/* Get the statistics of a tile. */
+struct TileStats *Stats_tile(const Stats_T stats, const size_t index) {
+	assert(stats != NULL);
+	assert(index < stats->tiles_across * stats->tiles_down);
+
+	return stats->tiles + index;
+	}
+
+/* Get the statistics of a rendering thread. */
+struct ThreadStats *Stats_thread(const Stats_T stats, const unsigned index) {
+	assert(stats != NULL);
+	assert(index < stats->thread_count);
+
+	return stats->threads + index;
+	}
+
+/* Finish recording a render. */
+void Stats_endRender(Stats_T stats, const double render_time) {
+	unsigned t; /* current thread */
+
+	assert(stats != NULL);
+
+	/* Anything a thread was not spending on its tiles - start-up, waiting on
+	the tile queue, or waiting for the other threads to finish - is idle. */
+	for (t = 0; t < stats->thread_count; t++) {
+		stats->threads[t].idle_time = render_time - stats->threads[t].busy_time;
+		if (stats->threads[t].idle_time < 0) stats->threads[t].idle_time = 0;
+		}
+
+	stats->render_time = render_time;
+	}
+
+/* Record the time taken to save the image. */
+void Stats_setSaveTime(Stats_T stats, const double save_time) {
+	assert(stats != NULL);
+
+	stats->save_time = save_time;
+	}
+
+/* Get the current time of a monotonic clock. */
+double Stats_now(void) {
+	struct timespec now; /* current time */
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+	}
+
+/* Write the statistics to a file as JSON. */
+bool Stats_writeJson(const Stats_T stats, const char *path) {
+	FILE *fp; /* file to write to */
+	size_t index; /* current tile index */
+	size_t tile_count; /* number of tiles */
+	unsigned t; /* current thread */
+	struct TileStats *tile; /* current tile */
+	unsigned long long iterations = 0; /* total iterations */
+	size_t escaped = 0; /* total escaped pixels */
+	size_t maxed = 0; /* total maxed-out pixels */
+	size_t skipped = 0; /* total skipped pixels */
+	double escape_time = 0; /* total time in the escape loop */
+	double draw_time = 0; /* total time in Image_setPixel */
+
+	assert(stats != NULL);
+	assert(path != NULL);
+
+	fp = fopen(path, "w");
+	if (fp == NULL) return false;
+
+	tile_count = stats->tiles_across * stats->tiles_down;
+	for (index = 0; index < tile_count; index++) {
+		tile = stats->tiles + index;
+		iterations += tile->iterations;
+		escaped += tile->escaped;
+		maxed += tile->maxed;
+		skipped += tile->skipped;
+		escape_time += tile->escape_time;
+		draw_time += tile->draw_time;
+		}
+
+	fprintf(fp, "{\n\t\"width\": %lu,\n\t\"height\": %lu,\n\
+\t\"tile_size\": %lu,\n\t\"render_time\": %f,\n\t\"save_time\": %f,\n",
+		stats->width, stats->height, stats->tile_size, stats->render_time,
+		stats->save_time);
+	fprintf(fp, "\t\"totals\": {\"iterations\": %llu, \"escaped\": %lu, \
+\"maxed\": %lu, \"skipped\": %lu, \"escape_time\": %f, \"draw_time\": %f},\n",
+		iterations, escaped, maxed, skipped, escape_time, draw_time);
+
+	fprintf(fp, "\t\"threads\": [\n");
+	for (t = 0; t < stats->thread_count; t++) {
+		fprintf(fp, "\t\t{\"id\": %u, \"tiles\": %lu, \"busy_time\": %f, \
+\"idle_time\": %f}%s\n", t, stats->threads[t].tiles,
+			stats->threads[t].busy_time, stats->threads[t].idle_time,
+			(t + 1 < stats->thread_count) ? "," : "");
+		}
+	fprintf(fp, "\t],\n");
+
+	fprintf(fp, "\t\"tiles\": [\n");
+	for (index = 0; index < tile_count; index++) {
+		tile = stats->tiles + index;
+		fprintf(fp, "\t\t{\"x\": %lu, \"y\": %lu, \"width\": %lu, \
+\"height\": %lu, \"thread\": %u, \"iterations\": %llu, \"escaped\": %lu, \
+\"maxed\": %lu, \"skipped\": %lu, \"escape_time\": %f, \"draw_time\": %f}%s\n",
+			tile->x, tile->y, tile->width, tile->height, tile->thread,
+			tile->iterations, tile->escaped, tile->maxed, tile->skipped,
+			tile->escape_time,
+			tile->draw_time, (index + 1 < tile_count) ? "," : "");
+		}
+	fprintf(fp, "\t]\n}\n");
+
+	return fclose(fp) == 0;
+	}
+
+/* Save a heatmap of the iterations executed per tile. */
+bool Stats_saveHeatmap(const Stats_T stats, const char *path) {
+	Image_T heatmap; /* heatmap image */
+	size_t index; /* current tile index */
+	size_t tile_count; /* number of tiles */
+	double density; /* iterations per pixel of the current tile */
+	double max_density = 0; /* highest iterations per pixel of any tile */
+	size_t w; /* current iterating width */
+	size_t h; /* current iterating height */
+	uint8_t red; /* red value of the tile color */
+	uint8_t green; /* green value of the tile color */
+	uint8_t blue; /* blue value of the tile color */
+	bool saved; /* whether or not the heatmap was saved */
+
+	assert(stats != NULL);
+	assert(path != NULL);
+
+	tile_count = stats->tiles_across * stats->tiles_down;
+	if (tile_count == 0) return false;
+
+	/* Scale by density rather than raw iterations so that the (smaller) edge
+	tiles are comparable to the rest. */
+	for (index = 0; index < tile_count; index++) {
+		density = (double) stats->tiles[index].iterations /
+			(stats->tiles[index].width * stats->tiles[index].height);
+		if (density > max_density) max_density = density;
+		}
+
+	heatmap = Image_new(stats->tiles_across * HEATMAP_CELL,
+		stats->tiles_down * HEATMAP_CELL);
+	if (heatmap == NULL) return false;
+
+	for (index = 0; index < tile_count; index++) {
+		density = (double) stats->tiles[index].iterations /
+			(stats->tiles[index].width * stats->tiles[index].height);
+		Stats_heatColor((max_density > 0) ? density / max_density : 0,
+			&red, &green, &blue);
+
+		for (h = 0; h < HEATMAP_CELL; h++) {
+			for (w = 0; w < HEATMAP_CELL; w++) {
+				Image_setPixel(heatmap,
+					(index % stats->tiles_across) * HEATMAP_CELL + w,
+					(index / stats->tiles_across) * HEATMAP_CELL + h,
+					red, green, blue);
+				}
+			}
+		}
+
+	saved = Image_save(heatmap, path);
+	Image_free(heatmap);
+
+	return saved;
+	}
+
+/* --- Internal Methods --- */
+/* Map a value in [0, 1] to a heatmap color. */
+static void Stats_heatColor(const double t, uint8_t *red, uint8_t *green,
+	uint8_t *blue) {
+	double r = 3 * t; /* red intensity */
+	double g = 3 * t - 1; /* green intensity */
+	double b = 3 * t - 2; /* blue intensity */
+
+	*red = (uint8_t) (255 * ((r > 1) ? 1 : (r < 0) ? 0 : r));
+	*green = (uint8_t) (255 * ((g > 1) ? 1 : (g < 0) ? 0 : g));
+	*blue = (uint8_t) (255 * ((b > 1) ? 1 : (b < 0) ? 0 : b));
+	}
@@ -0,0 +1,147 @@
+/*
+* stats.h
+* Author: Rushy Panchal
+* Description: Hot-path instrumentation for the renderer. Provides the Stats_T
+*	ADT, which records per-tile and per-thread counters and timings for a
+*	render and writes them out as JSON and as a heatmap image.
+*	The hooks in the renderer are only compiled in when STATS is defined
+*	(see `make stats`); this module itself has no cost unless it is used.
+*/
+
+#ifndef STATS_INCLUDED
+#define STATS_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct Stats *Stats_T;
+
+/* Counters and timings for a single tile of the image. */
+struct TileStats {
+	size_t x; /* leftmost column of the tile */
+	size_t y; /* topmost row of the tile */
+	size_t width; /* width of the tile */
+	size_t height; /* height of the tile */
+	unsigned thread; /* index of the thread that rendered the tile */
+	unsigned long long iterations; /* total iterations of z^exp + c */
+	size_t escaped; /* pixels that escaped before the iteration limit */
+	size_t maxed; /* pixels that ran every iteration (drawn) */
+	size_t skipped; /* pixels never iterated (the image's first row and column) */
+	double escape_time; /* seconds spent in the escape loop */
+	double draw_time; /* seconds spent in Image_setPixel */
+	};
+
+/* Timings for a single rendering thread. */
+struct ThreadStats {
+	size_t tiles; /* number of tiles rendered */
+	double busy_time; /* seconds spent rendering tiles */
+	double idle_time; /* seconds of the render spent not rendering tiles */
+	};
+
+/*
+* Create a new, empty statistics collector.
+* Returns
+*	(Stats_T) statistics collector (or NULL on memory exhaustion)
+*/
+Stats_T Stats_new(void);
+
+/*
+* Free the statistics collector.
+* Parameters
+*	Stats_T stats - collector to free
+*/
+void Stats_free(Stats_T stats);
+
+/*
+* Set the collector that the renderer records into. Only one render may be
+* recorded at a time.
+* Parameters
+*	Stats_T stats - collector to record into (or NULL to stop recording)
+*/
+void Stats_setActive(Stats_T stats);
+
+/*
+* Get the collector that the renderer records into.
+* Returns
+*	(Stats_T) active collector (or NULL if there is none)
+*/
+Stats_T Stats_getActive(void);
+
+/*
+* Prepare the collector for a render, discarding any previous render.
+* Parameters
+*	Stats_T stats - collector to prepare
+*	const size_t width - width of the image
+*	const size_t height - height of the image
+*	const size_t tile_size - width and height of a (full) tile
+*	const unsigned threads - number of rendering threads
+* Returns
+*	(bool) true on success, false on memory exhaustion
+*/
+bool Stats_beginRender(Stats_T stats, const size_t width, const size_t height,
+	const size_t tile_size, const unsigned threads);
+
+/*
+* Get the statistics of a tile. Tiles are numbered in row-major order.
+* Parameters
+*	const Stats_T stats - collector to get the tile from
+*	const size_t index - index of the tile
+* Returns
+*	(struct TileStats*) statistics of the tile
+*/
+struct TileStats *Stats_tile(const Stats_T stats, const size_t index);
+
+/*
+* Get the statistics of a rendering thread.
+* Parameters
+*	const Stats_T stats - collector to get the thread from
+*	const unsigned index - index of the thread
+* Returns
+*	(struct ThreadStats*) statistics of the thread
+*/
+struct ThreadStats *Stats_thread(const Stats_T stats, const unsigned index);
+
+/*
+* Finish recording a render. Computes the idle time of each thread.
+* Parameters
+*	Stats_T stats - collector to finish
+*	const double render_time - wall time of the render, in seconds
+*/
+void Stats_endRender(Stats_T stats, const double render_time);
+
+/*
+* Record the time taken to save the image.
+* Parameters
+*	Stats_T stats - collector to record into
+*	const double save_time - wall time of Image_save, in seconds
+*/
+void Stats_setSaveTime(Stats_T stats, const double save_time);
+
+/*
+* Get the current time of a monotonic clock.
+* Returns
+*	(double) current time, in seconds
+*/
+double Stats_now(void);
+
+/*
+* Write the statistics to a file as JSON.
+* Parameters
+*	const Stats_T stats - statistics to write
+*	const char *path - path of the file to write to
+* Returns
+*	(bool) true on success, false on failure
+*/
+bool Stats_writeJson(const Stats_T stats, const char *path);
+
+/*
+* Save a heatmap of the iterations executed per tile to a PNG file.
+* Parameters
+*	const Stats_T stats - statistics to draw
+*	const char *path - path of the file to save the heatmap to
+* Returns
+*	(bool) true on success, false on failure
+*/
+bool Stats_saveHeatmap(const Stats_T stats, const char *path);
+
+#endif
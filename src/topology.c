@@ -0,0 +1,284 @@
+/*
+* topology.c
+* Author: Rushy Panchal
+* Description: The NUMA topology of the machine. Implements topology.h.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <assert.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+#include "topology.h"
+
+#define NODE_PATH "/sys/devices/system/node"
+#define CPU_ONLINE_PATH "/sys/devices/system/cpu/online"
+#define MAX_CPUS 1024
+#define MAX_PATH 128
+
+/* A node, as a slice of the topology's processors. */
+struct TopologyNode {
+	unsigned id; /* system identifier of the node */
+	unsigned first; /* index of the node's first processor */
+	unsigned cpu_count; /* number of processors of the node */
+	};
+
+struct Topology {
+	unsigned cpus[MAX_CPUS]; /* processors, grouped by node */
+	struct TopologyNode nodes[TOPOLOGY_MAX_NODES]; /* nodes of the machine */
+	unsigned node_count; /* number of nodes */
+	bool simulated; /* whether or not the nodes are simulated */
+	};
+
+/* --- Internal Method Prototypes --- */
+/*
+* Read a sysfs list (such as "0-3,8,10-11") into a set of members.
+* Parameters
+*	const char *path - path of the list
+*	bool *members - (size) set to mark the members of the list in
+*	const unsigned size - size of the set; larger members are ignored
+* Returns
+*	(bool) true on success, false on failure
+*/
+static bool read_list(const char *path, bool *members, const unsigned size);
+
+/*
+* Find the processors the process may run on.
+* Parameters
+*	bool *allowed - (MAX_CPUS) set to mark the processors in
+*/
+static void allowed_cpus(bool *allowed);
+
+/*
+* Detect the nodes of the machine from sysfs.
+* Parameters
+*	Topology_T topology - topology to store the nodes in
+*	const bool *allowed - (MAX_CPUS) processors the process may run on
+* Returns
+*	(bool) true if any node was found, false otherwise
+*/
+static bool detect_nodes(Topology_T topology, const bool *allowed);
+
+/*
+* Split the processors evenly into simulated nodes.
+* Parameters
+*	Topology_T topology - topology to store the nodes in
+*	const bool *allowed - (MAX_CPUS) processors the process may run on
+*	const unsigned nodes - number of nodes to simulate
+*/
+static void simulate_nodes(Topology_T topology, const bool *allowed,
+	const unsigned nodes);
+
+/* Find the topology of the machine. */
+Topology_T Topology_new(const unsigned nodes) {
+	Topology_T topology; /* topology for client */
+	bool allowed[MAX_CPUS]; /* processors the process may run on */
+
+	topology = (Topology_T) calloc(1, sizeof(struct Topology));
+	if (topology == NULL) return NULL;
+
+	allowed_cpus(allowed);
+	if (nodes == 0 && detect_nodes(topology, allowed)) return topology;
+
+	simulate_nodes(topology, allowed, (nodes == 0) ? 1 : nodes);
+	return topology;
+	}
+
+/* Free the topology. */
+void Topology_free(Topology_T topology) {
+	free(topology);
+	}
+
+/* Get the number of nodes. */
+unsigned Topology_getNodeCount(const Topology_T topology) {
+	assert(topology != NULL);
+
+	return topology->node_count;
+	}
+
+/* Get the system identifier of a node. */
+unsigned Topology_getNodeId(const Topology_T topology, const unsigned node) {
+	assert(topology != NULL);
+	assert(node < topology->node_count);
+
+	return topology->nodes[node].id;
+	}
+
+/* Get the number of processors of a node. */
+unsigned Topology_getCpuCount(const Topology_T topology, const unsigned node) {
+	assert(topology != NULL);
+	assert(node < topology->node_count);
+
+	return topology->nodes[node].cpu_count;
+	}
+
+/* Check whether or not the topology is simulated. */
+bool Topology_isSimulated(const Topology_T topology) {
+	assert(topology != NULL);
+
+	return topology->simulated;
+	}
+
+/* Pin the calling thread to the processors of a node. */
+bool Topology_bind(const Topology_T topology, const unsigned node) {
+#ifdef __linux__
+	cpu_set_t set; /* processors of the node */
+	unsigned c; /* current processor */
+
+	assert(topology != NULL);
+	assert(node < topology->node_count);
+
+	CPU_ZERO(&set);
+	for (c = 0; c < topology->nodes[node].cpu_count; c++)
+		CPU_SET(topology->cpus[topology->nodes[node].first + c], &set);
+
+	return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) == 0;
+#else
+	assert(topology != NULL);
+	assert(node < topology->node_count);
+
+	return false;
+#endif
+	}
+
+/* --- Internal Methods --- */
+/* Read a sysfs list into a set of members. */
+static bool read_list(const char *path, bool *members, const unsigned size) {
+	FILE *fp; /* file pointer of the list */
+	char *line = NULL; /* contents of the list */
+	size_t line_size = 0; /* size of the line buffer */
+	char *cursor; /* current position in the line */
+	char *end; /* end of the current number */
+	unsigned long first; /* first member of the current range */
+	unsigned long last; /* last member of the current range */
+	bool parsed = true; /* whether or not the list was parsed */
+
+	memset(members, 0, sizeof(bool) * size);
+
+	fp = fopen(path, "r");
+	if (fp == NULL) return false;
+	if (getline(&line, &line_size, fp) < 0) {
+		free(line);
+		fclose(fp);
+		return false;
+		}
+	fclose(fp);
+
+	for (cursor = line; *cursor != '\0' && *cursor != '\n'; cursor = end + 1) {
+		first = strtoul(cursor, &end, 10);
+		if (end == cursor) {
+			parsed = false;
+			break;
+			}
+		last = first;
+		if (*end == '-') {
+			cursor = end + 1;
+			last = strtoul(cursor, &end, 10);
+			if (end == cursor) {
+				parsed = false;
+				break;
+				}
+			}
+		for (; first <= last && first < size; first++) members[first] = true;
+		if (*end != ',') break;
+		}
+
+	free(line);
+	return parsed;
+	}
+
+/* Find the processors the process may run on. */
+static void allowed_cpus(bool *allowed) {
+	long cpus; /* number of online processors */
+	unsigned c; /* current processor */
+#ifdef __linux__
+	cpu_set_t set; /* processors the process may run on */
+
+	if (sched_getaffinity(0, sizeof(cpu_set_t), &set) == 0) {
+		for (c = 0; c < MAX_CPUS; c++) allowed[c] = c < CPU_SETSIZE && CPU_ISSET(c, &set);
+		return;
+		}
+#endif
+
+	if (read_list(CPU_ONLINE_PATH, allowed, MAX_CPUS)) return;
+
+	cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (cpus < 1) cpus = 1;
+	for (c = 0; c < MAX_CPUS; c++) allowed[c] = c < cpus;
+	}
+
+/* Detect the nodes of the machine from sysfs. */
+static bool detect_nodes(Topology_T topology, const bool *allowed) {
+	bool online[TOPOLOGY_MAX_NODES]; /* nodes that are online */
+	bool members[MAX_CPUS]; /* processors of the current node */
+	char path[MAX_PATH]; /* path of the current node's processor list */
+	struct TopologyNode *node; /* current node */
+	unsigned total = 0; /* processors found so far */
+	unsigned id; /* identifier of the current node */
+	unsigned c; /* current processor */
+
+	if (! read_list(NODE_PATH "/online", online, TOPOLOGY_MAX_NODES)) return false;
+
+	for (id = 0; id < TOPOLOGY_MAX_NODES; id++) {
+		if (! online[id]) continue;
+
+		snprintf(path, MAX_PATH, NODE_PATH "/node%u/cpulist", id);
+		if (! read_list(path, members, MAX_CPUS)) continue;
+
+		node = topology->nodes + topology->node_count;
+		node->id = id;
+		node->first = total;
+		node->cpu_count = 0;
+		for (c = 0; c < MAX_CPUS; c++) {
+			if (members[c] && allowed[c]) {
+				topology->cpus[total++] = c;
+				node->cpu_count++;
+				}
+			}
+
+		/* Memory-only nodes (and nodes the process may not run on) cannot
+		run threads, so they are left out. */
+		if (node->cpu_count > 0) topology->node_count++;
+		}
+
+	topology->simulated = false;
+	return topology->node_count > 0;
+	}
+
+/* Split the processors evenly into simulated nodes. */
+static void simulate_nodes(Topology_T topology, const bool *allowed,
+	const unsigned nodes) {
+	unsigned count = 0; /* number of processors */
+	unsigned n; /* current node */
+	unsigned c; /* current processor */
+
+	for (c = 0; c < MAX_CPUS; c++) {
+		if (allowed[c]) topology->cpus[count++] = c;
+		}
+	if (count == 0) topology->cpus[count++] = 0;
+
+	topology->node_count = (nodes > TOPOLOGY_MAX_NODES) ? TOPOLOGY_MAX_NODES : nodes;
+	for (n = 0; n < topology->node_count; n++) {
+		topology->nodes[n].id = n;
+
+		/* With fewer processors than nodes, nodes share processors. */
+		if (count >= topology->node_count) {
+			topology->nodes[n].first = n * count / topology->node_count;
+			topology->nodes[n].cpu_count = (n + 1) * count / topology->node_count -
+				topology->nodes[n].first;
+			}
+		else {
+			topology->nodes[n].first = n % count;
+			topology->nodes[n].cpu_count = 1;
+			}
+		}
+
+	topology->simulated = true;
+	}
@@ -0,0 +1,88 @@
+/*
+* topology.h
+* Author: Rushy Panchal
+* Description: The NUMA topology of the machine. Provides the Topology_T ADT,
+*	which groups the processors available to the process by memory node. The
+*	topology is read from sysfs on Linux; elsewhere, or when asked to, the
+*	processors are split evenly into a simulated set of nodes so that
+*	node-aware code runs unchanged on a single-node machine.
+*/
+
+#ifndef TOPOLOGY_INCLUDED
+#define TOPOLOGY_INCLUDED
+
+#include <stdbool.h>
+
+#define TOPOLOGY_MAX_NODES 64
+
+typedef struct Topology *Topology_T;
+
+/*
+* Find the topology of the machine.
+* Parameters
+*	const unsigned nodes - number of nodes to simulate, or 0 to detect them
+* Returns
+*	(Topology_T) topology of the machine, or NULL on memory failure
+*
+* Note:
+*	If detection fails, a single node with every processor is simulated.
+*/
+Topology_T Topology_new(const unsigned nodes);
+
+/*
+* Free the topology.
+* Parameters
+*	Topology_T topology - topology to free
+*/
+void Topology_free(Topology_T topology);
+
+/*
+* Get the number of nodes (each with at least one processor).
+* Parameters
+*	const Topology_T topology - topology to get node count of
+* Returns
+*	(unsigned) number of nodes
+*/
+unsigned Topology_getNodeCount(const Topology_T topology);
+
+/*
+* Get the system identifier of a node.
+* Parameters
+*	const Topology_T topology - topology to get identifier from
+*	const unsigned node - index of the node
+* Returns
+*	(unsigned) identifier of the node (its index, if simulated)
+*/
+unsigned Topology_getNodeId(const Topology_T topology, const unsigned node);
+
+/*
+* Get the number of processors of a node.
+* Parameters
+*	const Topology_T topology - topology to get processor count from
+*	const unsigned node - index of the node
+* Returns
+*	(unsigned) number of processors of the node
+*/
+unsigned Topology_getCpuCount(const Topology_T topology, const unsigned node);
+
+/*
+* Check whether or not the topology is simulated.
+* Parameters
+*	const Topology_T topology - topology to check
+* Returns
+*	(bool) true if the nodes are simulated, false if they were detected
+*/
+bool Topology_isSimulated(const Topology_T topology);
+
+/*
+* Pin the calling thread to the processors of a node.
+* Parameters
+*	const Topology_T topology - topology of the node
+*	const unsigned node - index of the node
+* Returns
+*	(bool) true if the thread was pinned, false if pinning is unsupported or
+*		failed (the thread then runs unpinned)
+*/
+bool Topology_bind(const Topology_T topology, const unsigned node);
+
+#endif